@@ -0,0 +1,173 @@
+// Runs the EAST detector at several detector-scale values and the
+// projection detector on every region of the given images, and prints
+// their times and how well their boxes agree with full scale EAST, e.g.
+//   detector_benchmark data/tpp-sword-720p.toml sample_images/*.png
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "Config.hpp"
+#include "Metrics.hpp"
+#include "TextDetector.hpp"
+#include "ProjectionTextDetector.hpp"
+
+using namespace tppocr;
+
+namespace {
+
+// Least intersection over union for two boxes to count as the same text
+const double minOverlap = 0.5;
+const int runs = 10;
+// detector-scale values compared against full scale
+const float scales[] = {0.75f, 0.5f, 0.25f};
+
+std::vector<cv::Rect> getBoxes(const TextDetections & detections) {
+    std::vector<cv::Rect> boxes;
+
+    for (auto index : detections.indices) {
+        boxes.push_back(detections.detections.at(index).boundingRect());
+    }
+
+    return boxes;
+}
+
+// Number of boxes that overlap one of the other boxes enough
+size_t countMatched(const std::vector<cv::Rect> & boxes,
+        const std::vector<cv::Rect> & otherBoxes) {
+    size_t count = 0;
+
+    for (auto & box : boxes) {
+        for (auto & otherBox : otherBoxes) {
+            double intersection = (box & otherBox).area();
+            double overlap = intersection / (box.area() + otherBox.area() - intersection);
+
+            if (overlap >= minOverlap) {
+                count += 1;
+                break;
+            }
+        }
+    }
+
+    return count;
+}
+
+// Runs EAST on the image resized by the scale, as AppWorker::detectEAST
+// does, and returns the average milliseconds. Boxes are mapped back to
+// full resolution.
+double detectEAST(TextDetector & detector, const cv::Mat & image, float scale,
+        TextDetections & detections) {
+    cv::Mat scaledImage;
+    cv::Mat paddedImage;
+
+    if (scale == 1.0f) {
+        scaledImage = image;
+    } else {
+        cv::Size size(
+            std::max(1, static_cast<int>(std::lround(image.cols * scale))),
+            std::max(1, static_cast<int>(std::lround(image.rows * scale))));
+        cv::resize(image, scaledImage, size, 0, 0, cv::INTER_AREA);
+    }
+
+    // The network needs sizes that are multiples of 32
+    cv::copyMakeBorder(scaledImage, paddedImage,
+        0, (32 - scaledImage.rows % 32) % 32, 0, (32 - scaledImage.cols % 32) % 32,
+        cv::BORDER_CONSTANT, cv::Scalar());
+
+    cv::TickMeter tickMeter;
+    tickMeter.start();
+
+    for (int run = 0; run < runs; run++) {
+        detector.processImages({paddedImage}, {&detections});
+    }
+
+    tickMeter.stop();
+
+    for (auto index : detections.indices) {
+        auto & box = detections.detections.at(index);
+        box.center.x /= scale;
+        box.center.y /= scale;
+        box.size.width /= scale;
+        box.size.height /= scale;
+    }
+
+    return tickMeter.getTimeMilli() / runs;
+}
+
+}
+
+int main(int argc, char * argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: detector_benchmark <config> <image>..." << std::endl;
+        return 1;
+    }
+
+    auto config = std::make_shared<Config>();
+    config->parseFromTOML(argv[1]);
+
+    auto model = TextDetectorModel::read(config->detectorModelPath);
+    Metrics metrics;
+    TextDetector eastDetector(config, model, metrics);
+    ProjectionTextDetector projectionDetector(metrics);
+    TextDetections eastDetections;
+    TextDetections scaledDetections;
+    TextDetections projectionDetections;
+
+    // Recall is the fraction of the full scale EAST boxes that a box
+    // found at the scale overlaps
+    std::cout << "image\tregion\tdetector\tscale\tms\tboxes\trecall\tprecision\n";
+
+    for (int argIndex = 2; argIndex < argc; argIndex++) {
+        cv::Mat image = cv::imread(argv[argIndex]);
+
+        if (image.empty()) {
+            std::cerr << "Failed to read " << argv[argIndex] << std::endl;
+            return 1;
+        }
+
+        for (auto & region : config->regions) {
+            cv::Mat subImage = image(cv::Rect(region.x, region.y, region.width, region.height));
+            double referenceTime = detectEAST(eastDetector, subImage, 1.0f, eastDetections);
+            auto referenceBoxes = getBoxes(eastDetections);
+
+            auto printRow = [&](const char * detector, float scale, double time,
+                    const std::vector<cv::Rect> & boxes) {
+                double recall = referenceBoxes.empty() ? 1.0 :
+                    static_cast<double>(countMatched(referenceBoxes, boxes)) / referenceBoxes.size();
+                double precision = boxes.empty() ? 1.0 :
+                    static_cast<double>(countMatched(boxes, referenceBoxes)) / boxes.size();
+
+                std::cout << argv[argIndex] << '\t' << region.name << '\t'
+                    << detector << '\t' << scale << '\t' << time << '\t'
+                    << boxes.size() << '\t' << recall << '\t' << precision << '\n';
+            };
+
+            printRow("east", 1.0f, referenceTime, referenceBoxes);
+
+            for (float scale : scales) {
+                double time = detectEAST(eastDetector, subImage, scale, scaledDetections);
+                printRow("east", scale, time, getBoxes(scaledDetections));
+            }
+
+            cv::TickMeter projectionMeter;
+            projectionMeter.start();
+
+            for (int run = 0; run < runs; run++) {
+                projectionDetector.processImage(subImage, projectionDetections);
+            }
+
+            projectionMeter.stop();
+
+            printRow("projection", 1.0f, projectionMeter.getTimeMilli() / runs,
+                getBoxes(projectionDetections));
+        }
+    }
+
+    return 0;
+}
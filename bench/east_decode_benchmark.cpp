@@ -0,0 +1,140 @@
+// Times EASTDecoder against decoding one cell at a time as in the OpenCV
+// text detection sample, on random network outputs of a 720p frame
+
+#include <iostream>
+#include <random>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "EASTDecoder.hpp"
+
+using tppocr::EASTDecoder;
+
+namespace {
+
+const float threshold = 0.5f;
+
+void decodeReference(const cv::Mat & scores, const cv::Mat & geometry,
+        std::vector<cv::RotatedRect> & detections, std::vector<float> & confidences) {
+    const int height = scores.size[2];
+    const int width = scores.size[3];
+
+    detections.clear();
+    confidences.clear();
+
+    for (int y = 0; y < height; ++y) {
+        const float * scoresData = scores.ptr<float>(0, 0, y);
+        const float * x0_data = geometry.ptr<float>(0, 0, y);
+        const float * x1_data = geometry.ptr<float>(0, 1, y);
+        const float * x2_data = geometry.ptr<float>(0, 2, y);
+        const float * x3_data = geometry.ptr<float>(0, 3, y);
+        const float * anglesData = geometry.ptr<float>(0, 4, y);
+
+        for (int x = 0; x < width; ++x) {
+            if (scoresData[x] < threshold) {
+                continue;
+            }
+
+            float offsetX = x * 4.0f, offsetY = y * 4.0f;
+            float angle = anglesData[x];
+            float cosA = std::cos(angle);
+            float sinA = std::sin(angle);
+            float h = x0_data[x] + x2_data[x];
+            float w = x1_data[x] + x3_data[x];
+
+            cv::Point2f offset(
+                offsetX + cosA * x1_data[x] + sinA * x2_data[x],
+                offsetY - sinA * x1_data[x] + cosA * x2_data[x]);
+            cv::Point2f p1 = cv::Point2f(-sinA * h, -cosA * h) + offset;
+            cv::Point2f p3 = cv::Point2f(-cosA * w, sinA * w) + offset;
+            detections.push_back(cv::RotatedRect(0.5f * (p1 + p3),
+                cv::Size2f(w, h), -angle * 180.0f / (float)CV_PI));
+            confidences.push_back(scoresData[x]);
+        }
+    }
+}
+
+bool isClose(const cv::RotatedRect & a, const cv::RotatedRect & b) {
+    const float tolerance = 1e-3f;
+
+    return std::abs(a.center.x - b.center.x) < tolerance
+        && std::abs(a.center.y - b.center.y) < tolerance
+        && std::abs(a.size.width - b.size.width) < tolerance
+        && std::abs(a.size.height - b.size.height) < tolerance
+        && std::abs(a.angle - b.angle) < tolerance;
+}
+
+template<typename Function>
+double timeRuns(int runs, Function function) {
+    cv::TickMeter tickMeter;
+    tickMeter.start();
+
+    for (int run = 0; run < runs; run++) {
+        function();
+    }
+
+    tickMeter.stop();
+
+    return tickMeter.getTimeSec() / runs;
+}
+
+}
+
+int main(int argc, char * argv[]) {
+    // Fraction of cells above the threshold
+    double density = argc > 1 ? std::stod(argv[1]) : 0.05;
+    const int runs = 200;
+    const int height = 720 / 4;
+    const int width = 1280 / 4;
+
+    int scoresSize[] = {1, 1, height, width};
+    int geometrySize[] = {1, 5, height, width};
+    cv::Mat scores(4, scoresSize, CV_32F);
+    cv::Mat geometry(4, geometrySize, CV_32F);
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> distance(0.0f, 40.0f);
+    std::uniform_real_distribution<float> angle(-0.8f, 0.8f);
+
+    for (int index = 0; index < height * width; index++) {
+        scores.ptr<float>()[index] = unit(random) < density ? 0.9f : 0.1f;
+    }
+
+    for (int channel = 0; channel < 5; channel++) {
+        float * data = geometry.ptr<float>(0, channel);
+
+        for (int index = 0; index < height * width; index++) {
+            data[index] = channel < 4 ? distance(random) : angle(random);
+        }
+    }
+
+    std::vector<cv::RotatedRect> referenceDetections;
+    std::vector<float> referenceConfidences;
+    std::vector<cv::RotatedRect> detections;
+    std::vector<float> confidences;
+    EASTDecoder decoder;
+
+    double referenceTime = timeRuns(runs, [&]{
+        decodeReference(scores, geometry, referenceDetections, referenceConfidences);
+    });
+    double decoderTime = timeRuns(runs, [&]{
+        decoder.decode(scores, geometry, 0, threshold, detections, confidences);
+    });
+
+    bool isMatching = detections.size() == referenceDetections.size();
+
+    for (size_t index = 0; isMatching && index < detections.size(); index++) {
+        isMatching = isClose(detections[index], referenceDetections[index])
+            && confidences[index] == referenceConfidences[index];
+    }
+
+    std::cout << "Candidates: " << detections.size() << "\n"
+        << "Per cell decode: " << referenceTime * 1000 << " ms\n"
+        << "EASTDecoder: " << decoderTime * 1000 << " ms\n"
+        << "Results " << (isMatching ? "match" : "differ") << std::endl;
+
+    return isMatching ? 0 : 1;
+}
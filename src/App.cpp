@@ -3,6 +3,9 @@
 #include <stdio.h>
 #include <limits>
 #include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
 
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
@@ -15,96 +18,296 @@ namespace tppocr {
 
 App::App(std::shared_ptr<Config> config) :
     config(config),
-    inputStream(config) {
+    metrics(std::make_shared<Metrics>()),
+    textDetectorPool(std::make_shared<TextDetectorPool>(config, *metrics)),
+    lineRecognizerPool(std::make_shared<LineRecognizerPool>(config, *metrics)),
+    ocrCache(std::make_shared<OCRCache>(config->recognizerCacheSize, *metrics)),
+    clockModel(std::make_shared<ClockModel>(config->clockResyncInterval,
+        config->clockTolerance, *metrics)),
+    workerCount(std::thread::hardware_concurrency()),
+    // A whole frame must fit so frames can be admitted or dropped whole
+    workUnits(std::max<size_t>(
+        config->workQueueSize ? config->workQueueSize : std::max(workerCount, 1u),
+        config->regions.size())),
+    workUnitsOverflowPolicy(parseOverflowPolicy(config->workQueueOverflowPolicy)),
+    workUnitsDepthCounter(metrics->counter("work-queue-depth")),
+    workUnitsDroppedCounter(metrics->counter("work-queue-dropped")),
+    framesDroppedCounter(metrics->counter("work-queue-dropped-frames")),
+    clockSkipCounter(metrics->counter("clock-skipped-readings")),
+    inputStream(config),
+    // Enough buffers for the ring, the one being decoded, the queue, the one
+    // waiting to be queued, and one for each worker
+    framePool(config->decoderFrameRingSize + workUnits.capacity() + workerCount + 2,
+        inputStream.videoFrameWidth(), inputStream.videoFrameHeight(),
+        config->recognizerGrayscale, config->debugWindow, *metrics),
+    frameRing(config->decoderFrameRingSize) {
 
     inputStream.callback = std::bind(&App::frameCallback, this);
 
-    frameImage = cv::Mat(
-        inputStream.videoFrameHeight(),
-        inputStream.videoFrameWidth(),
-        CV_8UC3,
-        inputStream.videoFrameData()
-    );
+    for (auto & region : config->regions) {
+        // Glyph regions fall back to Tesseract so every region needs it
+        OCR::checkTrainedData(*config, region);
+
+        changeDetectors.emplace(region.name,
+            std::make_shared<RegionChangeDetector>(region));
+        detectionTrackers.emplace(region.name,
+            std::make_shared<DetectionTracker>(region));
+
+        if (region.recognizerType == TextRecognizerType::Glyph) {
+            auto atlas = std::make_shared<GlyphAtlas>();
+
+            if (!region.recognizerGlyphAtlasFilename.empty()) {
+                atlas->load(region.recognizerGlyphAtlasFilename);
+            }
+
+            glyphAtlases.emplace(region.name, atlas);
+        }
+    }
+
+    if (ocrCache->isEnabled() && !config->recognizerCacheFile.empty()) {
+        ocrCache->load(config->recognizerCacheFile);
+    }
+
     debugImage = cv::Mat(
         inputStream.videoFrameHeight(),
         inputStream.videoFrameWidth(),
         CV_8UC3
     );
+    colorConversionRect = getConversionRect(true);
+    grayConversionRect = getConversionRect(false);
 
     frameSkip = std::floor(inputStream.fps() / config->processingFPS);
+    inputStream.setFrameInterval(frameSkip + 1);
 
     std::cerr << "Skipping every " << frameSkip << " frame(s)." << std::endl;
 }
 
+OverflowPolicy App::parseOverflowPolicy(const std::string & name) {
+    if (name == "block") {
+        return OverflowPolicy::Block;
+    } else if (name == "drop-newest") {
+        return OverflowPolicy::DropNewest;
+    } else if (name == "drop-oldest") {
+        return OverflowPolicy::DropOldest;
+    } else {
+        throw std::runtime_error("Unknown work queue overflow policy " + name);
+    }
+}
+
 void App::run() {
-    running = true;
     startWorkers();
 
-    while (inputStream.isRunning()) {
-        inputStream.runOnce();
+    decoder = std::make_shared<std::thread>(std::bind(&App::decoderEntry, this));
+
+    while (auto frame = frameRing.pop()) {
+        processFrame(std::move(frame));
     }
 
+    decoder->join();
+
     std::cerr << "Stream ended" << std::endl;
 
-    running = false;
-    workUnitsConditionVar.notify_all();
+    workUnits.close();
 
     for (auto & thread : workers) {
         thread->join();
     }
+
+    if (ocrCache->isEnabled() && !config->recognizerCacheFile.empty()) {
+        ocrCache->save(config->recognizerCacheFile);
+    }
+
+    for (auto & region : config->regions) {
+        if (region.recognizerType == TextRecognizerType::Glyph
+                && !region.recognizerGlyphAtlasFilename.empty()) {
+            glyphAtlases.at(region.name)->save(region.recognizerGlyphAtlasFilename);
+        }
+    }
+
+    metrics->print(std::cerr);
+}
+
+cv::Rect App::getConversionRect(bool colorOnly) {
+    const cv::Rect frameRect(0, 0,
+        inputStream.videoFrameWidth(), inputStream.videoFrameHeight());
+
+    if (config->regions.empty()) {
+        return frameRect;
+    }
+
+    cv::Rect rect;
+
+    for (auto & region : config->regions) {
+        // In grayscale mode, only the text detector needs color
+        if (colorOnly && config->recognizerGrayscale && region.alwaysHasText) {
+            continue;
+        }
+
+        rect |= cv::Rect(region.x, region.y, region.width, region.height);
+    }
+
+    if (rect.empty()) {
+        return rect;
+    }
+
+    // Text blocks may extend a little past the region
+    const int margin = AppWorker::textBlockMargin;
+    rect.x -= margin;
+    rect.y -= margin;
+    rect.width += margin * 2;
+    rect.height += margin * 2;
+
+    return rect & frameRect;
+}
+
+void App::decoderEntry() {
+    while (inputStream.isRunning()) {
+        inputStream.runOnce();
+    }
+
+    frameRing.close();
 }
 
 void App::frameCallback() {
-    if (frameSkipCounter > 0) {
-        frameSkipCounter--;
-        return;
+    auto frame = framePool.acquire();
+
+    frame->frameID = inputStream.frameCounter();
+    frame->streamTime = inputStream.frameTime();
+
+    // Only the debug window needs pixels outside of the regions
+    if (config->debugWindow) {
+        inputStream.convertFrameToBGR(frame->debugImage.data,
+            frame->debugImage.step);
+
+        if (!colorConversionRect.empty()) {
+            frame->debugImage(colorConversionRect).copyTo(
+                frame->image(colorConversionRect));
+        }
+    } else if (!colorConversionRect.empty()) {
+        inputStream.convertFrameRegionToBGR(
+            colorConversionRect.x, colorConversionRect.y,
+            colorConversionRect.width, colorConversionRect.height,
+            frame->image.data, frame->image.step);
     }
 
-    auto image = cv::Mat(
-        inputStream.videoFrameHeight(),
-        inputStream.videoFrameWidth(),
-        CV_8UC3
-    );
-    auto debugImage = cv::Mat(
-        inputStream.videoFrameHeight(),
-        inputStream.videoFrameWidth(),
-        CV_8UC3
-    );
+    if (config->recognizerGrayscale) {
+        copyFrameLuma(*frame);
+    }
+
+    frameRing.push(std::move(frame));
+}
+
+void App::processFrame(FrameRef frame) {
+    // Each region is a separate task so idle workers can pick up the
+    // other regions of the same frame
+    frameRegions.clear();
 
-    inputStream.convertFrameToBGR();
-    frameImage.copyTo(image);
-    frameImage.copyTo(debugImage);
+    for (auto & region : config->regions) {
+        // The clock is modeled from the stream time between readings
+        if (!region.clockFormat.empty() && !clockModel->shouldSync(frame->streamTime)) {
+            clockSkipCounter.add();
+            continue;
+        }
+
+        frameRegions.push_back(&region);
+    }
 
-    std::unique_lock<std::mutex> workUnitsLock(workUnitsMutex);
-    workUnitsConditionVar.wait(workUnitsLock, [&]{ return workUnits.empty(); });
-    workUnitsLock.unlock();
+    if (frameRegions.empty()) {
+        // No worker will finish the frame
+        if (config->debugWindow) {
+            publishDebugImage(frame->debugImage);
+        }
+    } else if (!admitFrame(frameRegions.size())) {
+        framesDroppedCounter.add();
+        workUnitsDroppedCounter.add(frameRegions.size());
+        return;
+    }
 
-    workUnitsMutex.lock();
-    workUnits.emplace(processedFrameCounter, inputStream.frameCounter(),
-        image, debugImage);
-    workUnitsMutex.unlock();
-    workUnitsConditionVar.notify_one();
+    frame->dropped.store(false);
+    frame->pendingTasks.store(frameRegions.size());
 
+    for (auto region : frameRegions) {
+        // Only this thread pushes so the room made by admitFrame() stays
+        workUnits.push(WorkUnit(processedFrameCounter, frame, *region));
+    }
+
+    workUnitsDepthCounter.set(workUnits.size());
     processedFrameCounter += 1;
 
-    frameSkipCounter = frameSkip;
+    if (config->profiling && processedFrameCounter % 100 == 0) {
+        metrics->print(std::cerr);
+    }
 
     if (config->debugWindow) {
         if (!debugImageHasContent) {
+            // Dropped frames are never published, so don't wait forever
             std::unique_lock<std::mutex> debugImageLock(debugImageMutex);
-            debugImageConditionVar.wait(debugImageLock);
+            debugImageConditionVar.wait_for(debugImageLock, std::chrono::milliseconds(100),
+                [this]{ return debugImageHasContent; });
             debugImageLock.unlock();
         }
         drawDebugWindow();
     }
 }
 
-void App::startWorkers() {
-    auto count = std::thread::hardware_concurrency();
+bool App::admitFrame(size_t taskCount) {
+    if (workUnitsOverflowPolicy == OverflowPolicy::Block) {
+        return true;
+    }
 
-    std::cerr << "Worker count: " << count << std::endl;
+    while (workUnits.capacity() - workUnits.size() < taskCount) {
+        if (workUnitsOverflowPolicy == OverflowPolicy::DropNewest) {
+            return false;
+        }
 
-    for (size_t index = 0; index < count; index++) {
+        WorkUnit oldWorkUnit;
+
+        if (workUnits.tryPop(oldWorkUnit)) {
+            dropWorkUnit(oldWorkUnit);
+        }
+    }
+
+    return true;
+}
+
+void App::dropWorkUnit(WorkUnit & workUnit) {
+    auto & frame = *workUnit.frame;
+
+    // Workers skip the other regions of the frame and the last one to
+    // finish doesn't publish it
+    if (!frame.dropped.exchange(true)) {
+        framesDroppedCounter.add();
+    }
+
+    frame.pendingTasks.fetch_sub(1);
+    workUnitsDroppedCounter.add();
+}
+
+void App::copyFrameLuma(FrameBuffer & frame) {
+    auto lumaData = inputStream.videoFrameLumaData();
+    auto & rect = grayConversionRect;
+
+    if (lumaData) {
+        cv::Mat lumaImage(
+            inputStream.videoFrameHeight(),
+            inputStream.videoFrameWidth(),
+            CV_8UC1,
+            lumaData,
+            inputStream.videoFrameLumaLineSize()
+        );
+        lumaImage(rect).copyTo(frame.grayImage(rect));
+    } else {
+        inputStream.convertFrameRegionToBGR(
+            rect.x, rect.y, rect.width, rect.height,
+            frame.image.data, frame.image.step);
+        cv::cvtColor(frame.image(rect), frame.grayImage(rect), cv::COLOR_BGR2GRAY);
+    }
+}
+
+void App::startWorkers() {
+    std::cerr << "Worker count: " << workerCount << std::endl;
+
+    for (size_t index = 0; index < workerCount; index++) {
         auto thread = std::make_shared<std::thread>(std::bind(&App::workerEntry, this));
         workers.push_back(thread);
     }
@@ -113,36 +316,34 @@ void App::startWorkers() {
 void App::workerEntry() {
     std::cerr << "Worker started" << std::endl;
 
-    AppWorker worker(config);
-
-    while (running) {
-        workUnitsMutex.lock();
+    AppWorker worker(config, metrics, textDetectorPool, lineRecognizerPool,
+        changeDetectors, detectionTrackers, glyphAtlases, ocrCache, clockModel);
 
-        if (workUnits.empty()) {
-            workUnitsMutex.unlock();
-            std::unique_lock<std::mutex> workUnitsLock(workUnitsMutex);
-            workUnitsConditionVar.wait(workUnitsLock);
-            workUnitsLock.unlock();
-            continue;
-        }
+    WorkUnit workUnit;
 
-        auto workUnit = workUnits.front();
-        workUnits.pop();
-        workUnitsMutex.unlock();
+    while (workUnits.pop(workUnit)) {
+        workUnitsDepthCounter.set(workUnits.size());
+        bool isFrameDone = worker.processWorkUnit(workUnit);
 
-        workUnitsConditionVar.notify_all();
+        if (isFrameDone && config->debugWindow) {
+            publishDebugImage(workUnit.debugImage);
+        }
 
-        worker.processWorkUnit(workUnit);
-        debugImageMutex.lock();
-        workUnit.debugImage.copyTo(debugImage);
-        debugImageHasContent = true;
-        debugImageMutex.unlock();
-        debugImageConditionVar.notify_all();
+        // Return the frame buffer to the pool while waiting for more work
+        workUnit = WorkUnit();
     }
 
     std::cerr << "Worker stopped" << std::endl;
 }
 
+void App::publishDebugImage(const cv::Mat & frameDebugImage) {
+    debugImageMutex.lock();
+    frameDebugImage.copyTo(debugImage);
+    debugImageHasContent = true;
+    debugImageMutex.unlock();
+    debugImageConditionVar.notify_all();
+}
+
 void App::drawDebugWindow() {
      const std::string windowName = "tppocr";
 
@@ -5,7 +5,6 @@
 #include <functional>
 #include <unordered_map>
 #include <thread>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 
@@ -13,30 +12,52 @@
 #include <opencv2/freetype.hpp>
 
 #include "Config.hpp"
+#include "BoundedQueue.hpp"
+#include "Metrics.hpp"
 #include "OCR.hpp"
 #include "InputStream.hpp"
-#include "TextDetector.hpp"
+#include "FramePool.hpp"
+#include "FrameRing.hpp"
+#include "TextDetectorPool.hpp"
+#include "LineRecognizerPool.hpp"
 #include "WorkUnit.hpp"
 #include "WorkUnitResource.hpp"
+#include "AppWorker.hpp"
 
 namespace tppocr {
 
 class App {
     std::shared_ptr<Config> config;
+    std::shared_ptr<Metrics> metrics;
+    std::shared_ptr<TextDetectorPool> textDetectorPool;
+    std::shared_ptr<LineRecognizerPool> lineRecognizerPool;
+    RegionChangeDetectors changeDetectors;
+    DetectionTrackers detectionTrackers;
+    GlyphAtlases glyphAtlases;
+    std::shared_ptr<OCRCache> ocrCache;
+    std::shared_ptr<ClockModel> clockModel;
+    unsigned int workerCount;
     std::vector<std::shared_ptr<std::thread>> workers;
-    std::queue<WorkUnit> workUnits;
-    std::mutex workUnitsMutex;
-    std::condition_variable workUnitsConditionVar;
+    BoundedQueue<WorkUnit> workUnits;
+    OverflowPolicy workUnitsOverflowPolicy;
+    Counter & workUnitsDepthCounter;
+    Counter & workUnitsDroppedCounter;
+    Counter & framesDroppedCounter;
+    Counter & clockSkipCounter;
+    // Regions queued for the current frame
+    std::vector<const Region*> frameRegions;
+    std::shared_ptr<std::thread> decoder;
     InputStream inputStream;
-    cv::Mat frameImage;
+    FramePool framePool;
+    FrameRing frameRing;
+    cv::Rect colorConversionRect;
+    cv::Rect grayConversionRect;
     cv::Mat debugImage;
     std::mutex debugImageMutex;
     std::condition_variable debugImageConditionVar;
     bool debugImageHasContent = false;
     unsigned int frameSkip = 0;
-    unsigned int frameSkipCounter = 0;
     unsigned int processedFrameCounter = 0;
-    bool running = false;
 
 public:
     explicit App(std::shared_ptr<Config> config);
@@ -44,9 +65,17 @@ public:
     void run();
 
 private:
+    void decoderEntry();
+    static OverflowPolicy parseOverflowPolicy(const std::string & name);
     void frameCallback();
+    void processFrame(FrameRef frame);
+    bool admitFrame(size_t taskCount);
+    void dropWorkUnit(WorkUnit & workUnit);
+    cv::Rect getConversionRect(bool colorOnly);
+    void copyFrameLuma(FrameBuffer & frame);
     void startWorkers();
     void workerEntry();
+    void publishDebugImage(const cv::Mat & frameDebugImage);
     void drawDebugWindow();
 };
 
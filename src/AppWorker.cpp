@@ -1,5 +1,6 @@
 #include "AppWorker.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 #include <opencv2/highgui.hpp>
@@ -9,48 +10,198 @@
 
 namespace tppocr {
 
-AppWorker::AppWorker(std::shared_ptr<Config> config) :
-    config(config), resource(config),
-    dummyWorkUnit(0, 0, cv::Mat(), cv::Mat()), workUnit(dummyWorkUnit) {}
-
-void AppWorker::processWorkUnit(const WorkUnit & workUnit) {
+AppWorker::AppWorker(std::shared_ptr<Config> config,
+        std::shared_ptr<Metrics> metrics,
+        std::shared_ptr<TextDetectorPool> textDetectorPool,
+        std::shared_ptr<LineRecognizerPool> lineRecognizerPool,
+        const RegionChangeDetectors & changeDetectors,
+        const DetectionTrackers & detectionTrackers,
+        const GlyphAtlases & glyphAtlases,
+        std::shared_ptr<OCRCache> ocrCache,
+        std::shared_ptr<ClockModel> clockModel) :
+    config(config), metrics(metrics), textDetectorPool(textDetectorPool),
+    lineRecognizerPool(lineRecognizerPool),
+    changeDetectors(changeDetectors), detectionTrackers(detectionTrackers),
+    ocrCache(ocrCache), clockModel(clockModel),
+    resource(config, *metrics, glyphAtlases),
+    regionChangedCounter(metrics->counter("region-changed")),
+    regionUnchangedCounter(metrics->counter("region-unchanged")),
+    incrementalLineCounter(metrics->counter("recognizer-incremental-reused-lines")),
+    detectionTrackedCounter(metrics->counter("detector-tracked")),
+    detectionTrackFailedCounter(metrics->counter("detector-track-failed")) {}
+
+bool AppWorker::processWorkUnit(const WorkUnit & workUnit) {
     this->workUnit = workUnit;
 
-    for (auto & region : config->regions) {
-        processRegion(region);
+    // Frames are processed whole or not at all
+    if (!workUnit.frame->dropped.load()) {
+        processRegion(*workUnit.region);
+        stampRegionResult(*workUnit.region);
+    }
+
+    bool isFrameDone = workUnit.frame->pendingTasks.fetch_sub(1) == 1
+        && !workUnit.frame->dropped.load();
+
+    if (isFrameDone && config->debugWindow) {
+        drawFrameInfo(workUnit);
+    }
+
+    // Return the frame buffer to the pool
+    this->workUnit = WorkUnit();
+
+    return isFrameDone;
+}
+
+void AppWorker::stampRegionResult(const Region & region) {
+    regionResult.streamTime = workUnit.frame->streamTime;
+
+    auto & result = regionResult.ocrResult;
+    double clockTime;
+
+    // A reused reading belongs to the stream time of an earlier frame
+    if (!region.clockFormat.empty() && regionResult.hasText && !regionResult.isReused
+            && result.meanConfidence >= config->recognizerConfidenceThreshold
+            && ClockModel::parseTime(result.text, region.clockFormat, clockTime)) {
+        clockModel->observe(regionResult.streamTime, clockTime);
     }
 
-    drawFrameInfo(workUnit);
+    regionResult.hasWallTime = clockModel->getWallTime(
+        regionResult.streamTime, regionResult.wallTime);
+
+    if (regionResult.hasText
+            && result.meanConfidence >= config->recognizerConfidenceThreshold) {
+        // TODO: emit text with its wall time
+        // (in thread safe manner if threading)
+        // emitText();
+    }
+}
+
+std::unique_lock<std::mutex> AppWorker::lockDebugImage() {
+    // Other regions of the same frame may be drawing at the same time
+    return std::unique_lock<std::mutex>(workUnit.frame->debugImageMutex);
 }
 
 void AppWorker::processRegion(const Region & region) {
-    drawRegion(region);
+    if (config->debugWindow) {
+        auto lock = lockDebugImage();
+        drawRegion(region);
+    }
+
+    regionResult = RegionResult();
+    textBlockImage = cv::Mat();
+    auto & changeDetector = *changeDetectors.at(region.name);
+
+    if (!changeDetector.isEnabled()) {
+        detectRegion(region);
+        return;
+    }
+
+    auto & sourceImage = workUnit.grayImage.empty() ?
+        workUnit.image : workUnit.grayImage;
+    auto & signature = resource.regionSignatures.at(region.name);
+    changeDetector.computeSignature(
+        sourceImage(cv::Rect(region.x, region.y, region.width, region.height)),
+        signature);
+
+    if (changeDetector.getUnchangedResult(signature, regionResult)) {
+        regionResult.isReused = true;
+        // Same text as before so there is nothing new to emit
+        regionUnchangedCounter.add();
 
-    cv::Mat regionImage(
-        roundUp2(region.height, 32),
-        roundUp2(region.width, 32),
-        workUnit.image.type(),
-        cv::Scalar(0, 0)
-    );
+        if (config->debugWindow && regionResult.hasText) {
+            auto lock = lockDebugImage();
+            drawRegionResult(regionResult);
+        }
+
+        return;
+    }
+
+    regionChangedCounter.add();
+    detectRegion(region);
+    changeDetector.update(signature, workUnit.frameID, regionResult,
+        textBlockImage);
+}
+
+void AppWorker::detectRegion(const Region & region) {
+    cv::Rect regionRect(region.x, region.y, region.width, region.height);
+    textLines.clear();
 
     if (region.alwaysHasText) {
-        processTextBlock(region,
-            cv::Rect(region.x, region.y, region.width, region.height));
+        processTextBlock(region, regionRect);
         return;
     }
 
-    cv::Mat subImage = cv::Mat(workUnit.image,
-        cv::Rect(region.x, region.y, region.width, region.height));
+    // Most of the time there is plainly no text box on screen
+    for (auto & prefilter : resource.prefilters.at(region.name)) {
+        if (!prefilter.accepts(workUnit.image(regionRect))) {
+            return;
+        }
+    }
 
-    subImage.copyTo(regionImage(cv::Rect(0, 0, region.width, region.height)));
+    auto & tracker = *detectionTrackers.at(region.name);
+    TrackedDetection detection;
 
-    auto & textDetector = resource.textDetectors.at(region.name);
+    if (tracker.isEnabled() && tracker.getTracked(workUnit.id, detection)) {
+        // Boxes don't move, so unless the contents of the box clearly
+        // changed, skip running the detector
+        if (tracker.isValid(detection, computeEdgeDensity(detection.box))) {
+            detectionTrackedCounter.add();
+
+            if (detection.hasText) {
+                textLines = detection.lines;
+                processTextBlock(region, detection.box);
+            }
+
+            return;
+        }
+
+        detectionTrackFailedCounter.add();
+    }
+
+    cv::Rect textBlock;
+    bool hasText = findTextBlock(region, textBlock);
+
+    if (tracker.isEnabled()) {
+        detection.workUnitID = workUnit.id;
+        detection.hasText = hasText;
+        detection.box = hasText ? textBlock : regionRect;
+        detection.edgeDensity = computeEdgeDensity(detection.box);
+        detection.lines = textLines;
+        tracker.update(detection);
+    }
+
+    if (hasText) {
+        processTextBlock(region, textBlock);
+    }
+}
+
+float AppWorker::computeEdgeDensity(const cv::Rect & box) {
+    if (workUnit.grayImage.empty()) {
+        cv::cvtColor(workUnit.image(box), resource.edgeGrayImage, cv::COLOR_BGR2GRAY);
+        return DetectionTracker::computeEdgeDensity(resource.edgeGrayImage,
+            resource.edgeImage);
+    } else {
+        return DetectionTracker::computeEdgeDensity(workUnit.grayImage(box),
+            resource.edgeImage);
+    }
+}
+
+bool AppWorker::findTextBlock(const Region & region, cv::Rect & textBlock) {
+    cv::Rect regionRect(region.x, region.y, region.width, region.height);
+    cv::Mat subImage = cv::Mat(workUnit.image, regionRect);
+    auto & textDetections = resource.textDetections.at(region.name);
 
     cv::TickMeter tickMeter;
     if (config->profiling) {
         tickMeter.start();
     }
-    textDetector.processImage(regionImage);
+
+    if (region.detectorType == TextDetectorType::Projection) {
+        // Cheap enough to run at full resolution
+        resource.projectionTextDetector.processImage(subImage, textDetections);
+    } else {
+        detectEAST(region, subImage, textDetections);
+    }
 
     if (config->profiling) {
         tickMeter.stop();
@@ -58,40 +209,111 @@ void AppWorker::processRegion(const Region & region) {
             << " tick time: " << tickMeter.getTimeSec() << std::endl;
     }
 
-    auto & detections = textDetector.getDetections();
-    auto & confidences = textDetector.getConfidences();
-    auto & indices = textDetector.getIndices();
+    auto & detections = textDetections.detections;
+    auto & confidences = textDetections.confidences;
+    auto & indices = textDetections.indices;
 
     if (indices.empty()) {
-        return;
+        return false;
     }
 
     int minX = std::numeric_limits<int>::max();
     int minY = std::numeric_limits<int>::max();
     int maxX = std::numeric_limits<int>::min();
     int maxY = std::numeric_limits<int>::min();
+    detectionBoxes.clear();
 
     for (auto index : indices) {
         auto & box = detections.at(index);
         auto confidence = confidences.at(index);
         auto boundingBox = box.boundingRect();
 
+        detectionBoxes.push_back(boundingBox + cv::Point(region.x, region.y));
+
         minX = std::min(minX, region.x + boundingBox.x);
         minY = std::min(minY, region.y + boundingBox.y);
         maxX = std::max(maxX, region.x + boundingBox.x + boundingBox.width);
         maxY = std::max(maxY, region.y + boundingBox.y + boundingBox.height);
 
-        drawDetection(region, box, confidence);
+        if (config->debugWindow) {
+            auto lock = lockDebugImage();
+            drawDetection(region, box, confidence);
+        }
+    }
+
+    // Only the regions are converted into the pooled frame buffers, so
+    // pixels outside of them are stale from whatever frame came before
+    textBlock = cv::Rect(minX - textBlockMargin, minY - textBlockMargin,
+        maxX - minX + textBlockMargin * 2, maxY - minY + textBlockMargin * 2);
+    textBlock &= regionRect;
+
+    if (textBlock.empty()) {
+        return false;
+    }
+
+    if (region.recognizerLineMode) {
+        groupTextLines(textBlock);
+    }
+
+    return true;
+}
+
+void AppWorker::groupTextLines(const cv::Rect & textBlock) {
+    std::sort(detectionBoxes.begin(), detectionBoxes.end(),
+        [](const cv::Rect & a, const cv::Rect & b) {
+            return a.y + a.height / 2 < b.y + b.height / 2;
+        });
+
+    // A box whose vertical center is inside the current line is on it
+    for (auto & box : detectionBoxes) {
+        int centerY = box.y + box.height / 2;
+
+        if (!textLines.empty()) {
+            auto & line = textLines.back();
+
+            if (centerY >= line.y && centerY < line.y + line.height) {
+                line |= box;
+                continue;
+            }
+        }
+
+        textLines.push_back(box);
     }
 
-    minX = std::max(minX - 5, 0);
-    minY = std::max(minY - 5, 0);
-    maxX = std::min(maxX + 5, workUnit.image.cols);
-    maxY = std::min(maxY + 5, workUnit.image.rows);
+    for (auto & line : textLines) {
+        line.x -= textBlockMargin;
+        line.y -= textBlockMargin;
+        line.width += textBlockMargin * 2;
+        line.height += textBlockMargin * 2;
+        line &= textBlock;
+    }
+}
 
-    cv::Rect boundingBox(minX, minY, maxX - minX, maxY - minY);
+void AppWorker::detectEAST(const Region & region, const cv::Mat & subImage,
+        TextDetections & textDetections) {
+    // Padding outside of the region is never written and stays zero
+    auto & regionImage = resource.regionImages.at(region.name);
+
+    if (region.detectorScale == 1.0f) {
+        subImage.copyTo(regionImage(cv::Rect(0, 0, region.width, region.height)));
+    } else {
+        cv::Size detectorSize(region.detectorWidth(), region.detectorHeight());
+        cv::resize(subImage, regionImage(cv::Rect(cv::Point(0, 0), detectorSize)),
+            detectorSize, 0, 0, cv::INTER_AREA);
+    }
 
-    processTextBlock(region, boundingBox);
+    textDetectorPool->processImage(regionImage, textDetections);
+
+    if (region.detectorScale != 1.0f) {
+        // Map the boxes back to full resolution for recognition
+        for (auto index : textDetections.indices) {
+            auto & box = textDetections.detections.at(index);
+            box.center.x /= region.detectorScale;
+            box.center.y /= region.detectorScale;
+            box.size.width /= region.detectorScale;
+            box.size.height /= region.detectorScale;
+        }
+    }
 }
 
 void AppWorker::drawRegion(const Region & region) {
@@ -126,35 +348,212 @@ void AppWorker::drawDetection(const Region & region, const cv::RotatedRect & box
 }
 
 void AppWorker::processTextBlock(const Region & region, const cv::Rect & box) {
-    cv::Mat regionImage = cv::Mat(workUnit.image, box);
+    // Luma is enough for Tesseract which binarizes anyway
+    auto & sourceImage = workUnit.grayImage.empty() ?
+        workUnit.image : workUnit.grayImage;
+    cv::Mat regionImage = cv::Mat(sourceImage, box);
     auto & ocr = resource.textRecognizers.at(region.name);
+    auto & result = regionResult.ocrResult;
+    bool isCached = false;
+    uint64_t cacheKey = 0;
 
-    cv::TickMeter tickMeter;
-    if (config->profiling) {
-        tickMeter.start();
+    regionResult.hasText = true;
+    regionResult.textBlock = box;
+
+    if (ocrCache->isEnabled()) {
+        cacheKey = OCRCache::computeKey(region.name, regionImage,
+            resource.cacheKeyImage, resource.cacheSignatureImage);
+        isCached = ocrCache->get(cacheKey, box.size(), result);
     }
-    ocr.processImage(regionImage);
 
-    if (config->profiling) {
-        tickMeter.stop();
-        std::cerr << "Recognizing box " << region.name
-            << " tick time: " << tickMeter.getTimeSec() << std::endl;
+    bool isWholeBlockRecognized = false;
+
+    if (!isCached) {
+        cv::TickMeter tickMeter;
+        if (config->profiling) {
+            tickMeter.start();
+        }
+
+        bool isGlyphRegion = region.recognizerType == TextRecognizerType::Glyph;
+        auto glyphRecognizer = isGlyphRegion ?
+            &resource.glyphRecognizers.at(region.name) : nullptr;
+
+        if (glyphRecognizer && glyphRecognizer->processImage(regionImage, result)) {
+            // Matched every glyph, Tesseract isn't needed
+        } else if (region.recognizerIncremental
+                && recognizeIncrementally(region, box, regionImage)) {
+            // Only the lines below the unchanged ones were recognized
+        } else if (region.recognizerLineMode && !textLines.empty()) {
+            recognizeLines(region, box, sourceImage);
+        } else {
+            result = ocr.processImage(regionImage,
+                config->debugWindow ? &resource.thresholdedImage : nullptr);
+            isWholeBlockRecognized = true;
+
+            if (glyphRecognizer) {
+                glyphRecognizer->learn(result, config->recognizerConfidenceThreshold);
+            }
+        }
+
+        if (config->profiling) {
+            tickMeter.stop();
+            std::cerr << "Recognizing box " << region.name
+                << " tick time: " << tickMeter.getTimeSec() << std::endl;
+        }
+
+        if (ocrCache->isEnabled()) {
+            ocrCache->put(cacheKey, box.size(), result);
+        }
     }
 
-    auto text = ocr.getText();
+    if (region.recognizerIncremental) {
+        // Only a view into the frame, copied into the change detector's
+        // own buffer while the frame is still held
+        textBlockImage = regionImage;
+    }
 
-    auto confidence = ocr.getMeanConfidence();
+    if (config->debugWindow) {
+        auto lock = lockDebugImage();
+        drawTextBlock(region, box);
 
-    if (confidence >= config->recognizerConfidenceThreshold) {
-        // TODO: emit text
-        // (in thread safe manner if threading)
-        // emitText();
+        // Tesseract didn't see a cached or partially recognized block
+        if (isWholeBlockRecognized) {
+            drawOCRThresholdImage(box);
+        }
+
+        drawOCRLineBoundaries(result, box);
+        drawOCRText(result, box);
     }
+}
+
+bool AppWorker::recognizeIncrementally(const Region & region,
+        const cv::Rect & box, const cv::Mat & blockImage) {
+    auto & changeDetector = *changeDetectors.at(region.name);
+
+    if (!changeDetector.getLastResult(previousResult, previousTextBlockImage)
+            || !previousResult.hasText
+            || previousTextBlockImage.size() != previousResult.textBlock.size()) {
+        // Line boxes are only meaningful against the block they came from
+        return false;
+    }
+
+    auto & result = regionResult.ocrResult;
+    result = OCRResult();
+
+    // From the previous text block to the current one
+    cv::Point offset = previousResult.textBlock.tl() - box.tl();
+    cv::Rect blockRect(0, 0, box.width, box.height);
+    cv::Rect previousBlockRect(0, 0,
+        previousTextBlockImage.cols, previousTextBlockImage.rows);
+    int remainderY = 0;
+
+    // Text is revealed from the top so keep the lines up to the first
+    // one that changed
+    for (auto & line : previousResult.ocrResult.lines) {
+        cv::Rect lineRect = line.box + offset;
+
+        if (line.box.empty() || (line.box & previousBlockRect) != line.box
+                || (lineRect & blockRect) != lineRect) {
+            break;
+        }
 
-    drawTextBlock(region, box);
-    drawOCRThresholdImage(region, box);
-    drawOCRLineBoundaries(region, box);
-    drawOCRText(region, box);
+        changeDetector.computeSignature(
+            previousTextBlockImage(line.box), previousLineSignature);
+        changeDetector.computeSignature(blockImage(lineRect), lineSignature);
+
+        if (!changeDetector.isSimilar(lineSignature, previousLineSignature)) {
+            break;
+        }
+
+        result.lines.push_back(line);
+        result.lines.back().box = lineRect;
+
+        for (auto & word : result.lines.back().words) {
+            word.box += offset;
+        }
+
+        remainderY = lineRect.y + lineRect.height;
+    }
+
+    if (result.lines.empty()) {
+        return false;
+    }
+
+    incrementalLineCounter.add(result.lines.size());
+
+    if (box.height - remainderY >= minIncrementalHeight) {
+        auto & ocr = resource.textRecognizers.at(region.name);
+        auto remainder = ocr.processImage(
+            blockImage(cv::Rect(0, remainderY, box.width, box.height - remainderY)));
+
+        for (auto & line : remainder.lines) {
+            result.lines.push_back(line);
+            result.lines.back().box.y += remainderY;
+
+            for (auto & word : result.lines.back().words) {
+                word.box.y += remainderY;
+            }
+        }
+    }
+
+    finishMergedResult(result);
+
+    return true;
+}
+
+void AppWorker::recognizeLines(const Region & region, const cv::Rect & box,
+        const cv::Mat & sourceImage) {
+    auto & result = regionResult.ocrResult;
+
+    lineRecognizerPool->processLines(region, sourceImage, textLines, lineResults);
+
+    result = OCRResult();
+
+    // Lines are sorted from the top
+    for (size_t index = 0; index < textLines.size(); index++) {
+        cv::Point offset = textLines[index].tl() - box.tl();
+
+        for (auto & line : lineResults[index].lines) {
+            result.lines.push_back(line);
+            result.lines.back().box += offset;
+
+            for (auto & word : result.lines.back().words) {
+                word.box += offset;
+            }
+        }
+    }
+
+    finishMergedResult(result);
+}
+
+void AppWorker::finishMergedResult(OCRResult & result) {
+    // Lines loaded from the cache file have no words so weigh each line
+    // by its word count, at least one
+    float confidenceSum = 0;
+    size_t weightSum = 0;
+
+    for (auto & line : result.lines) {
+        size_t weight = std::max<size_t>(line.words.size(), 1);
+        float lineConfidenceSum = 0;
+
+        for (auto & word : line.words) {
+            lineConfidenceSum += word.confidence;
+        }
+
+        confidenceSum += line.words.empty() ? line.confidence : lineConfidenceSum;
+        weightSum += weight;
+
+        result.text += line.text;
+        result.text += '\n';
+    }
+
+    result.meanConfidence = weightSum ? confidenceSum / weightSum : 0;
+}
+
+void AppWorker::drawRegionResult(const RegionResult & result) {
+    drawTextBlock(*workUnit.region, result.textBlock);
+    drawOCRLineBoundaries(result.ocrResult, result.textBlock);
+    drawOCRText(result.ocrResult, result.textBlock);
 }
 
 void AppWorker::drawTextBlock(const Region & region, const cv::Rect & box) {
@@ -163,9 +562,8 @@ void AppWorker::drawTextBlock(const Region & region, const cv::Rect & box) {
         CV_RGB(255, 255, 0));
 }
 
-void AppWorker::drawOCRText(const Region & region, const cv::Rect & box) {
-    auto & ocr = resource.textRecognizers.at(region.name);
-    auto confidence = ocr.getMeanConfidence();
+void AppWorker::drawOCRText(const OCRResult & result, const cv::Rect & box) {
+    auto confidence = result.meanConfidence;
     char confidenceString[10];
     snprintf(confidenceString, 10, "%0.2f", confidence);
 
@@ -181,7 +579,7 @@ void AppWorker::drawOCRText(const Region & region, const cv::Rect & box) {
         cv::Point(box.x + box.width, box.y + offsetY * 0.75),
         cv::FONT_HERSHEY_PLAIN, 1.0, CV_RGB(0, 255, 255));
 
-    auto & text = ocr.getText();
+    auto & text = result.text;
 
     // cv::putText(debugImage, text,
     //     cv::Point(box.x, box.y + offsetY),
@@ -191,9 +589,8 @@ void AppWorker::drawOCRText(const Region & region, const cv::Rect & box) {
         16, CV_RGB(255, 127, 0), -1, cv::LINE_8, true);
 }
 
-void AppWorker::drawOCRThresholdImage(const Region & region, const cv::Rect & box) {
-    auto & ocr = resource.textRecognizers.at(region.name);
-    auto thresholdImage = ocr.getThresholdedImage();
+void AppWorker::drawOCRThresholdImage(const cv::Rect & box) {
+    auto & thresholdImage = resource.thresholdedImage;
     int offsetY = 0;
 
     if (box.y + box.height < workUnit.image.rows) {
@@ -207,9 +604,7 @@ void AppWorker::drawOCRThresholdImage(const Region & region, const cv::Rect & bo
     thresholdImage.copyTo(workUnit.debugImage(drawingRect));
 }
 
-void AppWorker::drawOCRLineBoundaries(const Region & region, const cv::Rect & box) {
-    auto & ocr = resource.textRecognizers.at(region.name);
-    auto lineBoundaries = ocr.getLineBoundaries();
+void AppWorker::drawOCRLineBoundaries(const OCRResult & result, const cv::Rect & box) {
     int offsetY = 0;
 
     if (box.y + box.height < workUnit.image.rows) {
@@ -218,7 +613,8 @@ void AppWorker::drawOCRLineBoundaries(const Region & region, const cv::Rect & bo
         offsetY = -box.height;
     }
 
-    for (auto & lineBoundary : lineBoundaries) {
+    for (auto & line : result.lines) {
+        auto & lineBoundary = line.box;
         auto drawingRect = cv::Rect(
             box.x + lineBoundary.x,
             box.y + lineBoundary.y + offsetY,
@@ -230,8 +626,15 @@ void AppWorker::drawOCRLineBoundaries(const Region & region, const cv::Rect & bo
 }
 
 void AppWorker::drawFrameInfo(const WorkUnit & workUnit) {
-    char text[50];
-    snprintf(text, 50, "Frame %d, id %d", workUnit.frameID, workUnit.id);
+    char text[80];
+    double wallTime;
+
+    if (clockModel->getWallTime(workUnit.frame->streamTime, wallTime)) {
+        snprintf(text, 80, "Frame %d, id %d, time %.1f", workUnit.frameID,
+            workUnit.id, wallTime);
+    } else {
+        snprintf(text, 80, "Frame %d, id %d", workUnit.frameID, workUnit.id);
+    }
 
     cv::putText(workUnit.debugImage, text,
         cv::Point(0, 40),
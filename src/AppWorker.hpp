@@ -1,33 +1,101 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
+#include "Metrics.hpp"
 #include "WorkUnitResource.hpp"
+#include "TextDetectorPool.hpp"
+#include "LineRecognizerPool.hpp"
 #include "WorkUnit.hpp"
 #include "Region.hpp"
+#include "OCR.hpp"
+#include "RegionChangeDetector.hpp"
+#include "DetectionTracker.hpp"
+#include "OCRCache.hpp"
+#include "ClockModel.hpp"
 
 namespace tppocr {
 
+typedef std::unordered_map<std::string,std::shared_ptr<RegionChangeDetector>>
+    RegionChangeDetectors;
+typedef std::unordered_map<std::string,std::shared_ptr<DetectionTracker>>
+    DetectionTrackers;
+
 class AppWorker {
     std::shared_ptr<Config> config;
+    std::shared_ptr<Metrics> metrics;
+    std::shared_ptr<TextDetectorPool> textDetectorPool;
+    std::shared_ptr<LineRecognizerPool> lineRecognizerPool;
+    RegionChangeDetectors changeDetectors;
+    DetectionTrackers detectionTrackers;
+    std::shared_ptr<OCRCache> ocrCache;
+    std::shared_ptr<ClockModel> clockModel;
     WorkUnitResource resource;
-    WorkUnit dummyWorkUnit;
-    WorkUnit & workUnit;
+    WorkUnit workUnit;
+    RegionResult regionResult;
+    RegionResult previousResult;
+    // Pixels of the current text block in the frame, and a copy of the
+    // previous one owned by this worker
+    cv::Mat textBlockImage;
+    cv::Mat previousTextBlockImage;
+    // Detection boxes and the text lines grouped from them, in frame
+    // coordinates
+    std::vector<cv::Rect> detectionBoxes;
+    std::vector<cv::Rect> textLines;
+    std::vector<OCRResult> lineResults;
+    cv::Mat lineSignature;
+    cv::Mat previousLineSignature;
+    Counter & regionChangedCounter;
+    Counter & regionUnchangedCounter;
+    Counter & incrementalLineCounter;
+    Counter & detectionTrackedCounter;
+    Counter & detectionTrackFailedCounter;
 
 public:
-    AppWorker(std::shared_ptr<Config> config);
+    // Padding in pixels added around detected text before recognition
+    static constexpr int textBlockMargin = 5;
+    // Shortest area below the unchanged lines worth recognizing
+    static constexpr int minIncrementalHeight = 8;
+
+    AppWorker(std::shared_ptr<Config> config, std::shared_ptr<Metrics> metrics,
+        std::shared_ptr<TextDetectorPool> textDetectorPool,
+        std::shared_ptr<LineRecognizerPool> lineRecognizerPool,
+        const RegionChangeDetectors & changeDetectors,
+        const DetectionTrackers & detectionTrackers,
+        const GlyphAtlases & glyphAtlases,
+        std::shared_ptr<OCRCache> ocrCache,
+        std::shared_ptr<ClockModel> clockModel);
 
-    void processWorkUnit(const WorkUnit & workUnit);
+    // Returns whether this was the last region of the frame to finish
+    // and the frame wasn't dropped
+    bool processWorkUnit(const WorkUnit & workUnit);
 private:
+    void stampRegionResult(const Region & region);
+    std::unique_lock<std::mutex> lockDebugImage();
     void processRegion(const Region & region);
+    void detectRegion(const Region & region);
+    float computeEdgeDensity(const cv::Rect & box);
+    bool findTextBlock(const Region & region, cv::Rect & textBlock);
+    void groupTextLines(const cv::Rect & textBlock);
+    void detectEAST(const Region & region, const cv::Mat & subImage,
+        TextDetections & textDetections);
+    void drawRegionResult(const RegionResult & result);
     void drawRegion(const Region & region);
     void drawDetection(const Region & region, const cv::RotatedRect & box,
         float confidence);
     void processTextBlock(const Region & region, const cv::Rect & box);
+    bool recognizeIncrementally(const Region & region, const cv::Rect & box,
+        const cv::Mat & blockImage);
+    void recognizeLines(const Region & region, const cv::Rect & box,
+        const cv::Mat & sourceImage);
+    void finishMergedResult(OCRResult & result);
     void drawTextBlock(const Region & region, const cv::Rect & box);
-    void drawOCRText(const Region & region, const cv::Rect & box);
-    void drawOCRThresholdImage(const Region & region, const cv::Rect & box);
-    void drawOCRLineBoundaries(const Region & region, const cv::Rect & box);
+    void drawOCRText(const OCRResult & result, const cv::Rect & box);
+    void drawOCRThresholdImage(const cv::Rect & box);
+    void drawOCRLineBoundaries(const OCRResult & result, const cv::Rect & box);
     void drawFrameInfo(const WorkUnit & workUnit);
 };
 
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <utility>
+#include <stddef.h>
+
+namespace tppocr {
+
+enum class OverflowPolicy {
+    Block,
+    DropNewest,
+    DropOldest
+};
+
+enum class PushResult {
+    Pushed,
+    // The queue was full and the given item was discarded
+    DroppedNewest,
+    // The queue was full and the oldest item was discarded to make room
+    DroppedOldest,
+    Closed
+};
+
+// Bounded multi-producer multi-consumer queue.
+//
+// The fast path is lock-free (based on Dmitry Vyukov's bounded MPMC queue).
+// A mutex and condition variables are only used to put threads to sleep
+// when the queue is empty or, for the blocking policy, full.
+template<typename T>
+class BoundedQueue {
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t capacity_;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueuePosition{0};
+    alignas(64) std::atomic<size_t> dequeuePosition{0};
+    std::atomic<bool> closed{false};
+
+    std::mutex waitMutex;
+    std::condition_variable notEmptyConditionVar;
+    std::condition_variable notFullConditionVar;
+    std::atomic<unsigned int> waitingConsumers{0};
+    std::atomic<unsigned int> waitingProducers{0};
+
+public:
+    explicit BoundedQueue(size_t capacity) :
+        capacity_(capacity),
+        cells(new Cell[capacity]) {
+
+        if (capacity == 0) {
+            throw std::runtime_error("BoundedQueue capacity must not be zero");
+        }
+
+        for (size_t index = 0; index < capacity; index++) {
+            cells[index].sequence.store(index, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    // Approximate number of items when other threads are using the queue
+    size_t size() const {
+        auto enqueued = enqueuePosition.load(std::memory_order_relaxed);
+        auto dequeued = dequeuePosition.load(std::memory_order_relaxed);
+
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    bool tryPush(T & value) {
+        auto position = enqueuePosition.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto & cell = cells[position % capacity_];
+            auto sequence = cell.sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position);
+
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1,
+                        std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    notifyConsumer();
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T & value) {
+        auto position = dequeuePosition.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto & cell = cells[position % capacity_];
+            auto sequence = cell.sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position + 1);
+
+            if (difference == 0) {
+                if (dequeuePosition.compare_exchange_weak(position, position + 1,
+                        std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(position + capacity_, std::memory_order_release);
+                    notifyProducer();
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    PushResult push(T value, OverflowPolicy policy = OverflowPolicy::Block) {
+        bool droppedOldest = false;
+
+        while (!closed.load(std::memory_order_acquire)) {
+            if (tryPush(value)) {
+                return droppedOldest ? PushResult::DroppedOldest : PushResult::Pushed;
+            }
+
+            switch (policy) {
+            case OverflowPolicy::DropNewest:
+                return PushResult::DroppedNewest;
+            case OverflowPolicy::DropOldest: {
+                T oldValue;
+
+                if (tryPop(oldValue)) {
+                    droppedOldest = true;
+                }
+                break;
+            }
+            case OverflowPolicy::Block:
+                waitUntil(waitingProducers, notFullConditionVar,
+                    [&]{ return size() < capacity_; });
+                break;
+            }
+        }
+
+        return PushResult::Closed;
+    }
+
+    // Removes the oldest item, blocking while empty.
+    // Returns false if the queue is closed and empty.
+    bool pop(T & value) {
+        while (true) {
+            if (tryPop(value)) {
+                return true;
+            }
+
+            if (closed.load(std::memory_order_acquire)) {
+                // Items may still have been pushed right before closing
+                return tryPop(value);
+            }
+
+            waitUntil(waitingConsumers, notEmptyConditionVar,
+                [&]{ return size() > 0; });
+        }
+    }
+
+    void close() {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        closed.store(true, std::memory_order_release);
+        lock.unlock();
+        notEmptyConditionVar.notify_all();
+        notFullConditionVar.notify_all();
+    }
+
+private:
+    template<typename Predicate>
+    void waitUntil(std::atomic<unsigned int> & waitingCount,
+            std::condition_variable & conditionVar, Predicate predicate) {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        waitingCount.fetch_add(1);
+        // Pairs with the fence in notify() so either we see the new state
+        // or the other side sees us waiting
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!predicate() && !closed.load(std::memory_order_acquire)) {
+            conditionVar.wait(lock);
+        }
+
+        waitingCount.fetch_sub(1);
+    }
+
+    void notify(std::atomic<unsigned int> & waitingCount,
+            std::condition_variable & conditionVar) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (waitingCount.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            conditionVar.notify_one();
+        }
+    }
+
+    void notifyConsumer() {
+        notify(waitingConsumers, notEmptyConditionVar);
+    }
+
+    void notifyProducer() {
+        notify(waitingProducers, notFullConditionVar);
+    }
+};
+
+}
@@ -0,0 +1,119 @@
+#include "ClockModel.hpp"
+
+#include <cmath>
+#include <ctime>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+namespace tppocr {
+
+ClockModel::ClockModel(double resyncInterval, double tolerance, Metrics & metrics) :
+    resyncInterval(resyncInterval),
+    tolerance(tolerance),
+    syncCounter(metrics.counter("clock-syncs")),
+    discontinuityCounter(metrics.counter("clock-discontinuities")),
+    rejectCounter(metrics.counter("clock-rejected-readings")) {}
+
+bool ClockModel::shouldSync(double streamTime) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // A reading may be on its way from a worker already
+    if (isSyncPending && streamTime - syncRequestTime < syncRetryDelay
+            && streamTime >= syncRequestTime) {
+        return false;
+    }
+
+    if (hasOffset && !hasCandidate && streamTime - lastSyncTime < resyncInterval
+            && streamTime >= lastSyncTime) {
+        return false;
+    }
+
+    isSyncPending = true;
+    syncRequestTime = streamTime;
+
+    return true;
+}
+
+void ClockModel::observe(double streamTime, double wallTime) {
+    std::lock_guard<std::mutex> lock(mutex);
+    double observedOffset = wallTime - streamTime;
+
+    isSyncPending = false;
+    syncCounter.add();
+
+    if (!hasOffset) {
+        hasOffset = true;
+        addOffset(observedOffset);
+        lastSyncTime = streamTime;
+        return;
+    }
+
+    if (std::abs(observedOffset - offset) <= tolerance) {
+        addOffset(observedOffset);
+        lastSyncTime = streamTime;
+        hasCandidate = false;
+        return;
+    }
+
+    // A misread and a jump of the clock look the same, so only accept a
+    // new offset once a second reading agrees with it
+    if (hasCandidate && std::abs(observedOffset - candidateOffset) <= tolerance) {
+        discontinuityCounter.add();
+        recentOffsets.clear();
+        addOffset(candidateOffset);
+        addOffset(observedOffset);
+        lastSyncTime = streamTime;
+        hasCandidate = false;
+    } else {
+        rejectCounter.add();
+        hasCandidate = true;
+        candidateOffset = observedOffset;
+    }
+}
+
+void ClockModel::addOffset(double observedOffset) {
+    recentOffsets.push_back(observedOffset);
+
+    if (recentOffsets.size() > offsetWindowSize) {
+        recentOffsets.pop_front();
+    }
+
+    // The clock shows whole seconds, so the largest recent offset is the
+    // closest to the true one. Only recent readings count so drift either
+    // way and small misreads age out.
+    offset = *std::max_element(recentOffsets.begin(), recentOffsets.end());
+}
+
+bool ClockModel::getWallTime(double streamTime, double & wallTime) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!hasOffset) {
+        return false;
+    }
+
+    wallTime = streamTime + offset;
+
+    return true;
+}
+
+bool ClockModel::parseTime(const std::string & text, const std::string & format,
+        double & wallTime) {
+    std::tm time = {};
+    std::istringstream stream(text);
+    stream >> std::get_time(&time, format.c_str());
+
+    if (stream.fail()) {
+        return false;
+    }
+
+#ifdef _MSC_VER
+    wallTime = _mkgmtime(&time);
+#else
+    wallTime = timegm(&time);
+#endif
+
+    return true;
+}
+
+}
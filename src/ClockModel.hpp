@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <deque>
+
+#include "Metrics.hpp"
+
+namespace tppocr {
+
+// Models the wall clock time shown on screen as the stream presentation
+// time plus an offset, so the clock only needs to be read occasionally.
+//
+// Shared by all workers.
+class ClockModel {
+    double resyncInterval;
+    double tolerance;
+    std::mutex mutex;
+    bool hasOffset = false;
+    double offset = 0;
+    // Offsets of the latest readings that agreed with the model
+    std::deque<double> recentOffsets;
+    double lastSyncTime = 0;
+    // Reading that disagreed with the model, kept until confirmed
+    bool hasCandidate = false;
+    double candidateOffset = 0;
+    bool isSyncPending = false;
+    double syncRequestTime = 0;
+    Counter & syncCounter;
+    Counter & discontinuityCounter;
+    Counter & rejectCounter;
+
+public:
+    // Seconds of stream time to wait for a requested reading before
+    // requesting another one
+    static constexpr double syncRetryDelay = 1.0;
+    // Readings the offset is estimated from
+    static constexpr size_t offsetWindowSize = 8;
+
+    explicit ClockModel(double resyncInterval, double tolerance, Metrics & metrics);
+
+    // Whether the on-screen clock should be read at the given stream time
+    bool shouldSync(double streamTime);
+
+    // Adds a reading of the on-screen clock in seconds since the epoch
+    void observe(double streamTime, double wallTime);
+
+    // Returns false if the clock hasn't been read yet
+    bool getWallTime(double streamTime, double & wallTime);
+
+    // Parses on-screen clock text as UTC with a strftime style format
+    static bool parseTime(const std::string & text, const std::string & format,
+        double & wallTime);
+
+private:
+    void addOffset(double observedOffset);
+};
+
+}
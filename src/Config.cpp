@@ -21,11 +21,26 @@ void Config::parseFromTOML(const std::string path) {
     }
 
     processingFPS = getTOMLNode(table, "processing-fps").as_floating_point()->get();
+    decoderSkipNonReferenceFrames = table["decoder-skip-nonreference-frames"].value_or<bool>(false);
+    decoderThreads = getTOMLCount(table, "decoder-threads", 0);
+    decoderThreadType = table["decoder-thread-type"].value_or<std::string>("frame+slice");
+    decoderFrameRingSize = getTOMLCount(table, "decoder-frame-ring-size", 4, 1);
+    workQueueSize = getTOMLCount(table, "work-queue-size", 0);
+    workQueueOverflowPolicy = table["work-queue-overflow"].value_or<std::string>("block");
     tessdataPath = getTOMLNode(table, "tessdata").as_string()->get();
+    tessdataBestPath = table["tessdata-best"].value_or<std::string>("");
     detectorModelPath = getTOMLNode(table, "detector-model").as_string()->get();
+    detectorInstances = getTOMLCount(table, "detector-instances", 1, 1);
+    detectorBatchSize = getTOMLCount(table, "detector-batch-size", 8, 1);
+    detectorBatchTimeout = table["detector-batch-timeout"].value_or<double>(0.005);
     detectorConfidenceThreshold = getTOMLNode(table, "detector-confidence-threshold").as_floating_point()->get();
     detectorNonmaximumSuppressionThreshold = getTOMLNode(table, "detector-nonmaximum-suppression-threshold").as_floating_point()->get();
     recognizerConfidenceThreshold = getTOMLNode(table, "recognizer-confidence-threshold").as_floating_point()->get();
+    recognizerGrayscale = table["recognizer-grayscale"].value_or<bool>(false);
+    recognizerCacheSize = getTOMLCount(table, "recognizer-cache-size", 0);
+    recognizerCacheFile = table["recognizer-cache-file"].value_or<std::string>("");
+    clockResyncInterval = table["clock-resync-interval"].value_or<double>(60.0);
+    clockTolerance = table["clock-tolerance"].value_or<double>(2.0);
 
     for (const auto & node : *table["region"].as_array()) {
         const auto & regionConfig = *node.as_table();
@@ -38,6 +53,112 @@ void Config::parseFromTOML(const std::string path) {
 
         region.alwaysHasText = regionConfig["always-has-text"].value_or<bool>(false);
         region.patternFilename = regionConfig["recognizer-pattern-file"].value_or<std::string>("");
+        region.detectorScale = regionConfig["detector-scale"].value_or<double>(1.0);
+        auto detectorType = regionConfig["detector"].value_or<std::string>("east");
+
+        if (detectorType == "east") {
+            region.detectorType = TextDetectorType::EAST;
+        } else if (detectorType == "projection") {
+            region.detectorType = TextDetectorType::Projection;
+        } else {
+            throw std::runtime_error("Unknown detector '" + detectorType + "' in region " + region.name);
+        }
+
+        region.detectorInterval = regionConfig["detector-interval"].value_or<int64_t>(1);
+        region.changeTolerance = regionConfig["change-tolerance"].value_or<double>(-1.0);
+        auto recognizerType = regionConfig["recognizer"].value_or<std::string>("tesseract");
+
+        if (recognizerType == "tesseract") {
+            region.recognizerType = TextRecognizerType::Tesseract;
+        } else if (recognizerType == "glyph") {
+            region.recognizerType = TextRecognizerType::Glyph;
+        } else {
+            throw std::runtime_error("Unknown recognizer '" + recognizerType + "' in region " + region.name);
+        }
+
+        auto recognizerEngine = regionConfig["recognizer-engine"].value_or<std::string>("lstm");
+
+        if (recognizerEngine == "lstm") {
+            region.recognizerEngine = TextRecognizerEngine::LSTM;
+        } else if (recognizerEngine == "legacy") {
+            region.recognizerEngine = TextRecognizerEngine::Legacy;
+        } else if (recognizerEngine == "combined") {
+            region.recognizerEngine = TextRecognizerEngine::Combined;
+        } else {
+            throw std::runtime_error("Unknown recognizer-engine '" + recognizerEngine + "' in region " + region.name);
+        }
+
+        region.clockFormat = regionConfig["clock-format"].value_or<std::string>("");
+        region.recognizerGlyphAtlasFilename = regionConfig["recognizer-glyph-atlas"].value_or<std::string>("");
+        region.recognizerGlyphThreshold = regionConfig["recognizer-glyph-threshold"].value_or<double>(0.85);
+        region.recognizerGlyphMargin = regionConfig["recognizer-glyph-margin"].value_or<double>(0.1);
+        region.recognizerLanguages = regionConfig["recognizer-languages"].value_or<std::string>(region.recognizerLanguages);
+        region.recognizerPageSegMode = regionConfig["recognizer-page-segmentation-mode"].value_or<int64_t>(-1);
+        region.recognizerWhitelist = regionConfig["recognizer-whitelist"].value_or<std::string>("");
+        region.recognizerFallbackLanguages = regionConfig["recognizer-fallback-languages"].value_or<std::string>("");
+        region.recognizerFallbackThreshold = regionConfig["recognizer-fallback-threshold"].value_or<double>(recognizerConfidenceThreshold);
+        region.recognizerBestTier = regionConfig["recognizer-best-tier"].value_or<bool>(false);
+        region.recognizerIncremental = regionConfig["recognizer-incremental"].value_or<bool>(false);
+        region.recognizerLineMode = regionConfig["recognizer-line-mode"].value_or<bool>(false);
+        auto lineInstances = regionConfig["recognizer-line-instances"].value_or<int64_t>(4);
+
+        if (lineInstances < 1) {
+            throw std::runtime_error("recognizer-line-instances must be at least 1 in region " + region.name);
+        }
+
+        region.recognizerLineInstances = lineInstances;
+
+        if (auto prefilters = regionConfig["prefilter"].as_array()) {
+            for (const auto & prefilterNode : *prefilters) {
+                auto prefilterTable = prefilterNode.as_table();
+
+                if (!prefilterTable) {
+                    throw std::runtime_error("prefilter must be a table in region " + region.name);
+                }
+
+                region.prefilters.push_back(parsePrefilter(*prefilterTable, region.name));
+            }
+        }
+
+        if (auto variables = regionConfig["recognizer-variables"].as_table()) {
+            for (auto && entry : *variables) {
+                region.recognizerVariables.emplace_back(
+                    std::string(entry.first),
+                    getTOMLVariableValue(entry.second, region.name));
+            }
+        }
+
+        if (region.detectorScale <= 0) {
+            throw std::runtime_error("detector-scale must be positive in region " + region.name);
+        }
+
+        if (region.detectorInterval < 1) {
+            throw std::runtime_error("detector-interval must be at least 1 in region " + region.name);
+        }
+
+        if (region.recognizerIncremental && region.changeTolerance < 0) {
+            throw std::runtime_error("recognizer-incremental requires change-tolerance in region " + region.name);
+        }
+
+        if (region.recognizerType == TextRecognizerType::Glyph) {
+            // The atlas is only complete once it has every whitelisted character
+            if (region.recognizerWhitelist.empty()) {
+                throw std::runtime_error("recognizer = \"glyph\" requires recognizer-whitelist in region " + region.name);
+            }
+
+            // Only results of the whole block are learned from
+            if (region.recognizerIncremental || region.recognizerLineMode) {
+                throw std::runtime_error("recognizer = \"glyph\" can't be combined with recognizer-incremental or recognizer-line-mode in region " + region.name);
+            }
+        }
+
+        if (region.recognizerLanguages.empty()) {
+            throw std::runtime_error("recognizer-languages must not be empty in region " + region.name);
+        }
+
+        if (region.recognizerPageSegMode < -1 || region.recognizerPageSegMode > 13) {
+            throw std::runtime_error("recognizer-page-segmentation-mode must be between 0 and 13 in region " + region.name);
+        }
 
         regions.push_back(region);
 
@@ -45,6 +166,59 @@ void Config::parseFromTOML(const std::string path) {
     }
 }
 
+RegionPrefilter Config::parsePrefilter(const toml::table & table,
+        const std::string & regionName) {
+    RegionPrefilter prefilter;
+    auto type = table["type"].value_or<std::string>("");
+
+    if (type == "edge-density") {
+        prefilter.type = RegionPrefilter::Type::EdgeDensity;
+    } else if (type == "color-fraction") {
+        prefilter.type = RegionPrefilter::Type::ColorFraction;
+    } else if (type == "template") {
+        prefilter.type = RegionPrefilter::Type::Template;
+        prefilter.templateFilename = table["file"].value_or<std::string>("");
+
+        if (prefilter.templateFilename.empty()) {
+            throw std::runtime_error("Template prefilter needs a file in region " + regionName);
+        }
+    } else {
+        throw std::runtime_error("Unknown prefilter type '" + type + "' in region " + regionName);
+    }
+
+    prefilter.name = regionName + "-" + type;
+    prefilter.minimum = table["min"].value_or<double>(0.0);
+
+    if (auto color = table["lower-color"].as_array()) {
+        for (size_t index = 0; index < 3 && index < color->size(); index++) {
+            prefilter.lowerColor[index] = (*color)[index].value_or<int64_t>(0);
+        }
+    }
+
+    if (auto color = table["upper-color"].as_array()) {
+        for (size_t index = 0; index < 3 && index < color->size(); index++) {
+            prefilter.upperColor[index] = (*color)[index].value_or<int64_t>(255);
+        }
+    }
+
+    return prefilter;
+}
+
+std::string Config::getTOMLVariableValue(const toml::node & node,
+        const std::string & regionName) {
+    if (auto value = node.as_string()) {
+        return value->get();
+    } else if (auto value = node.as_integer()) {
+        return std::to_string(value->get());
+    } else if (auto value = node.as_floating_point()) {
+        return std::to_string(value->get());
+    } else if (auto value = node.as_boolean()) {
+        return value->get() ? "1" : "0";
+    } else {
+        throw std::runtime_error("Unsupported recognizer-variables value in region " + regionName);
+    }
+}
+
 toml::node_view<toml::node> Config::getTOMLNode(toml::table & table, const std::string key) {
     auto view = table[key];
 
@@ -55,4 +229,15 @@ toml::node_view<toml::node> Config::getTOMLNode(toml::table & table, const std::
     }
 }
 
+int64_t Config::getTOMLCount(toml::table & table, const std::string key,
+        int64_t defaultValue, int64_t minimum) {
+    auto value = table[key].value_or<int64_t>(defaultValue);
+
+    if (value < minimum) {
+        throw std::runtime_error(key + " must be at least " + std::to_string(minimum));
+    }
+
+    return value;
+}
+
 }
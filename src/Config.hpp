@@ -21,17 +21,38 @@ public:
 
     std::string url;
     std::string tessdataPath;
+    std::string tessdataBestPath;
     std::string detectorModelPath;
+    size_t detectorInstances = 1;
+    size_t detectorBatchSize = 8;
+    double detectorBatchTimeout = 0.005;
     double processingFPS = 60;
+    bool decoderSkipNonReferenceFrames = false;
+    int decoderThreads = 0;
+    std::string decoderThreadType = "frame+slice";
+    size_t decoderFrameRingSize = 4;
+    size_t workQueueSize = 0;
+    std::string workQueueOverflowPolicy = "block";
     std::vector<Region> regions;
     float detectorConfidenceThreshold = 0.5;
     float detectorNonmaximumSuppressionThreshold = 0.4;
     float recognizerConfidenceThreshold = 0.7;
+    bool recognizerGrayscale = false;
+    size_t recognizerCacheSize = 0;
+    std::string recognizerCacheFile;
+    double clockResyncInterval = 60;
+    double clockTolerance = 2;
 
     void parseFromTOML(const std::string path);
 
 private:
     toml::node_view<toml::node> getTOMLNode(toml::table & table, const std::string key);
+    int64_t getTOMLCount(toml::table & table, const std::string key,
+        int64_t defaultValue, int64_t minimum = 0);
+    RegionPrefilter parsePrefilter(const toml::table & table,
+        const std::string & regionName);
+    std::string getTOMLVariableValue(const toml::node & node,
+        const std::string & regionName);
 
 };
 
@@ -0,0 +1,67 @@
+#include "DetectionTracker.hpp"
+
+#include <cstdlib>
+
+#include <opencv2/imgproc.hpp>
+
+namespace tppocr {
+
+DetectionTracker::DetectionTracker(const Region & region) :
+    region(region) {}
+
+bool DetectionTracker::isEnabled() const {
+    return region.detectorInterval > 1;
+}
+
+bool DetectionTracker::getTracked(unsigned int workUnitID,
+        TrackedDetection & detection) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!hasDetection) {
+        return false;
+    }
+
+    // Workers may process frames slightly out of order
+    auto distance = std::llabs(static_cast<long long>(workUnitID)
+        - static_cast<long long>(this->detection.workUnitID));
+
+    if (distance >= region.detectorInterval) {
+        return false;
+    }
+
+    detection = this->detection;
+
+    return true;
+}
+
+bool DetectionTracker::isValid(const TrackedDetection & detection,
+        float edgeDensity) const {
+    float minDensity = detection.edgeDensity * densityRatio - densitySlack;
+    float maxDensity = detection.edgeDensity / densityRatio + densitySlack;
+
+    return edgeDensity >= minDensity && edgeDensity <= maxDensity;
+}
+
+void DetectionTracker::update(const TrackedDetection & detection) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (hasDetection && detection.workUnitID < this->detection.workUnitID) {
+        return;
+    }
+
+    this->detection = detection;
+    hasDetection = true;
+}
+
+float DetectionTracker::computeEdgeDensity(const cv::Mat & grayImage,
+        cv::Mat & edgeImage) {
+    if (grayImage.empty()) {
+        return 0;
+    }
+
+    cv::Canny(grayImage, edgeImage, 50, 150);
+
+    return static_cast<float>(cv::countNonZero(edgeImage)) / grayImage.total();
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "Region.hpp"
+
+namespace tppocr {
+
+// Outcome of the last full text detection of a region
+struct TrackedDetection {
+    unsigned int workUnitID = 0;
+    bool hasText = false;
+    // Text block, or the whole region if there was no text, in frame
+    // coordinates
+    cv::Rect box;
+    // Fraction of edge pixels inside the box
+    float edgeDensity = 0;
+    // Text lines within the box for line mode recognition
+    std::vector<cv::Rect> lines;
+};
+
+// Lets a region reuse its last text detection for the following frames
+// as long as the edge density inside the box stays about the same.
+//
+// Shared by all workers.
+class DetectionTracker {
+    const Region & region;
+    std::mutex mutex;
+    bool hasDetection = false;
+    TrackedDetection detection;
+
+public:
+    // Edge density may drop to this fraction of the detected one or rise by
+    // its inverse before the box is considered stale
+    static constexpr float densityRatio = 0.5f;
+    // Absolute density change always allowed, for nearly empty boxes
+    static constexpr float densitySlack = 0.01f;
+
+    explicit DetectionTracker(const Region & region);
+
+    bool isEnabled() const;
+
+    // Copies the last detection if it is recent enough to be reused
+    bool getTracked(unsigned int workUnitID, TrackedDetection & detection);
+
+    bool isValid(const TrackedDetection & detection, float edgeDensity) const;
+
+    // Stores the detection unless a later one was already stored
+    void update(const TrackedDetection & detection);
+
+    // Fraction of Canny edge pixels in the gray image
+    static float computeEdgeDensity(const cv::Mat & grayImage, cv::Mat & edgeImage);
+};
+
+}
@@ -0,0 +1,185 @@
+#include "EASTDecoder.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace tppocr {
+
+void EASTDecoder::decode(const cv::Mat & scores, const cv::Mat & geometry,
+        int batchIndex, float threshold,
+        std::vector<cv::RotatedRect> & detections,
+        std::vector<float> & confidences) {
+    CV_Assert(scores.dims == 4);
+    CV_Assert(geometry.dims == 4);
+    CV_Assert(scores.size[0] > batchIndex);
+    CV_Assert(geometry.size[0] > batchIndex);
+    CV_Assert(scores.size[1] == 1);
+    CV_Assert(geometry.size[1] == 5);
+    CV_Assert(scores.size[2] == geometry.size[2]);
+    CV_Assert(scores.size[3] == geometry.size[3]);
+    CV_Assert(scores.isContinuous() && geometry.isContinuous());
+
+    const int height = scores.size[2];
+    const int width = scores.size[3];
+    const float * scoresData = scores.ptr<float>(batchIndex, 0);
+
+    candidates.clear();
+
+    for (int y = 0; y < height; ++y) {
+        findCandidates(scoresData + y * width, width, y * width, threshold);
+    }
+
+#if CV_SIMD
+    cv::vx_cleanup();
+#endif
+
+    // Output storage keeps its capacity between frames
+    detections.clear();
+    confidences.clear();
+
+    if (candidates.empty()) {
+        return;
+    }
+
+    gatherCandidates(geometry, batchIndex, width);
+
+    // Same as cos() and sin() of each angle to about 1e-6
+    cv::polarToCart(cv::noArray(), angles, cosines, sines);
+
+    computeBoxes();
+
+    detections.resize(candidates.size());
+    confidences.resize(candidates.size());
+
+    for (size_t index = 0; index < candidates.size(); index++) {
+        detections[index] = cv::RotatedRect(
+            cv::Point2f(centersX[index], centersY[index]),
+            cv::Size2f(widths[index], heights[index]),
+            -angles[index] * 180.0f / (float)CV_PI);
+        confidences[index] = scoresData[candidates[index]];
+    }
+}
+
+void EASTDecoder::findCandidates(const float * scoresData, int width,
+        int offset, float threshold) {
+    int x = 0;
+
+#if CV_SIMD
+    // Most cells are far below the threshold, so reject whole vectors
+    // and only look at the lanes of vectors that have a hit
+    const int lanes = CV_SIMD_WIDTH / sizeof(float);
+
+    for (; x <= width - lanes; x += lanes) {
+        if (cv::v_reduce_max(cv::vx_load(scoresData + x)) < threshold) {
+            continue;
+        }
+
+        for (int lane = 0; lane < lanes; lane++) {
+            if (scoresData[x + lane] >= threshold) {
+                candidates.push_back(offset + x + lane);
+            }
+        }
+    }
+#endif
+
+    for (; x < width; x++) {
+        if (scoresData[x] >= threshold) {
+            candidates.push_back(offset + x);
+        }
+    }
+}
+
+void EASTDecoder::gatherCandidates(const cv::Mat & geometry, int batchIndex,
+        int width) {
+    const size_t count = candidates.size();
+    const float * anglesData = geometry.ptr<float>(batchIndex, 4);
+
+    angles.resize(count);
+    originsX.resize(count);
+    originsY.resize(count);
+
+    for (auto & values : distances) {
+        values.resize(count);
+    }
+
+    // Distances from the cell to the top, right, bottom and left edges
+    for (int channel = 0; channel < 4; channel++) {
+        const float * data = geometry.ptr<float>(batchIndex, channel);
+        auto & values = distances[channel];
+
+        for (size_t index = 0; index < count; index++) {
+            values[index] = data[candidates[index]];
+        }
+    }
+
+    for (size_t index = 0; index < count; index++) {
+        const int cell = candidates[index];
+
+        angles[index] = anglesData[cell];
+        // Multiply by 4 because feature maps are 4 times less than input image
+        originsX[index] = (cell % width) * 4.0f;
+        originsY[index] = (cell / width) * 4.0f;
+    }
+}
+
+void EASTDecoder::computeBoxes() {
+    const int count = static_cast<int>(candidates.size());
+    const float * top = distances[0].data();
+    const float * right = distances[1].data();
+    const float * bottom = distances[2].data();
+    const float * left = distances[3].data();
+
+    centersX.resize(count);
+    centersY.resize(count);
+    widths.resize(count);
+    heights.resize(count);
+
+    // The box corner at the right and bottom edges is the origin rotated
+    // about the cell; the center is halfway to the opposite corner:
+    //   offset = origin + (cos * right + sin * bottom, cos * bottom - sin * right)
+    //   center = offset - 0.5 * (sin * h + cos * w, cos * h - sin * w)
+    int index = 0;
+
+#if CV_SIMD
+    const int lanes = CV_SIMD_WIDTH / sizeof(float);
+    const cv::v_float32 half = cv::vx_setall_f32(0.5f);
+
+    for (; index <= count - lanes; index += lanes) {
+        cv::v_float32 cosA = cv::vx_load(cosines.data() + index);
+        cv::v_float32 sinA = cv::vx_load(sines.data() + index);
+        cv::v_float32 rightValues = cv::vx_load(right + index);
+        cv::v_float32 bottomValues = cv::vx_load(bottom + index);
+        cv::v_float32 h = cv::vx_load(top + index) + bottomValues;
+        cv::v_float32 w = rightValues + cv::vx_load(left + index);
+
+        cv::v_float32 offsetX = cv::vx_load(originsX.data() + index)
+            + cv::v_fma(cosA, rightValues, sinA * bottomValues);
+        cv::v_float32 offsetY = cv::vx_load(originsY.data() + index)
+            + cosA * bottomValues - sinA * rightValues;
+        cv::v_float32 centerX = offsetX - half * cv::v_fma(sinA, h, cosA * w);
+        cv::v_float32 centerY = offsetY - half * (cosA * h - sinA * w);
+
+        cv::v_store(centersX.data() + index, centerX);
+        cv::v_store(centersY.data() + index, centerY);
+        cv::v_store(widths.data() + index, w);
+        cv::v_store(heights.data() + index, h);
+    }
+
+    cv::vx_cleanup();
+#endif
+
+    for (; index < count; index++) {
+        const float cosA = cosines[index];
+        const float sinA = sines[index];
+        const float h = top[index] + bottom[index];
+        const float w = right[index] + left[index];
+        const float offsetX = originsX[index] + cosA * right[index] + sinA * bottom[index];
+        const float offsetY = originsY[index] + cosA * bottom[index] - sinA * right[index];
+
+        centersX[index] = offsetX - 0.5f * (sinA * h + cosA * w);
+        centersY[index] = offsetY - 0.5f * (cosA * h - sinA * w);
+        widths[index] = w;
+        heights[index] = h;
+    }
+}
+
+}
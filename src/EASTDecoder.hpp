@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace tppocr {
+
+// Turns the score and geometry maps of the EAST network into rotated boxes.
+//
+// Cells above the threshold are gathered into separate arrays first so
+// the angles and box corners of all of them are computed in vector
+// registers instead of one cell at a time.
+class EASTDecoder {
+    // Score map cells above the threshold, as row major offsets
+    std::vector<int> candidates;
+    // Inputs and results of each candidate, one array per value
+    std::vector<float> angles;
+    std::vector<float> cosines;
+    std::vector<float> sines;
+    std::vector<float> distances[4];
+    std::vector<float> originsX;
+    std::vector<float> originsY;
+    std::vector<float> centersX;
+    std::vector<float> centersY;
+    std::vector<float> widths;
+    std::vector<float> heights;
+
+public:
+    // Decodes the image at the batch index of the 4D score (N,1,H,W) and
+    // geometry (N,5,H,W) network outputs. The output vectors keep their
+    // capacity between calls.
+    void decode(const cv::Mat & scores, const cv::Mat & geometry,
+        int batchIndex, float threshold,
+        std::vector<cv::RotatedRect> & detections,
+        std::vector<float> & confidences);
+
+private:
+    void findCandidates(const float * scoresData, int width, int offset,
+        float threshold);
+    void gatherCandidates(const cv::Mat & geometry, int batchIndex, int width);
+    void computeBoxes();
+};
+
+}
@@ -0,0 +1,129 @@
+#include "FramePool.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace tppocr {
+
+FrameRef::FrameRef(FrameBuffer * buffer) : buffer(buffer) {
+    if (buffer) {
+        buffer->referenceCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+FrameRef::FrameRef(const FrameRef & other) : FrameRef(other.buffer) {}
+
+FrameRef::FrameRef(FrameRef && other) noexcept : buffer(other.buffer) {
+    other.buffer = nullptr;
+}
+
+FrameRef::~FrameRef() {
+    reset();
+}
+
+FrameRef & FrameRef::operator=(const FrameRef & other) {
+    if (buffer != other.buffer) {
+        reset();
+        buffer = other.buffer;
+
+        if (buffer) {
+            buffer->referenceCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    return *this;
+}
+
+FrameRef & FrameRef::operator=(FrameRef && other) noexcept {
+    if (this != &other) {
+        reset();
+        buffer = other.buffer;
+        other.buffer = nullptr;
+    }
+
+    return *this;
+}
+
+FrameBuffer * FrameRef::get() const {
+    return buffer;
+}
+
+FrameBuffer * FrameRef::operator->() const {
+    return buffer;
+}
+
+FrameBuffer & FrameRef::operator*() const {
+    return *buffer;
+}
+
+FrameRef::operator bool() const {
+    return buffer != nullptr;
+}
+
+void FrameRef::reset() {
+    if (buffer && buffer->referenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        buffer->pool->release(buffer);
+    }
+
+    buffer = nullptr;
+}
+
+FramePool::FramePool(size_t capacity, int width, int height,
+        bool hasGrayImage, bool hasDebugImage, Metrics & metrics) :
+    allocationCounter(metrics.counter("frame-pool-allocations")),
+    acquireCounter(metrics.counter("frame-pool-acquires")),
+    waitCounter(metrics.counter("frame-pool-waits")) {
+
+    if (capacity == 0) {
+        throw std::runtime_error("FramePool capacity must not be zero");
+    }
+
+    freeBuffers.reserve(capacity);
+
+    for (size_t index = 0; index < capacity; index++) {
+        auto buffer = std::make_unique<FrameBuffer>();
+        buffer->pool = this;
+
+        allocateImage(buffer->image, width, height, CV_8UC3);
+
+        if (hasGrayImage) {
+            allocateImage(buffer->grayImage, width, height, CV_8UC1);
+        }
+
+        if (hasDebugImage) {
+            allocateImage(buffer->debugImage, width, height, CV_8UC3);
+        }
+
+        freeBuffers.push_back(buffer.get());
+        buffers.push_back(std::move(buffer));
+    }
+}
+
+void FramePool::allocateImage(cv::Mat & image, int width, int height, int type) {
+    image.create(height, width, type);
+    allocationCounter.add();
+}
+
+FrameRef FramePool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (freeBuffers.empty()) {
+        waitCounter.add();
+        conditionVar.wait(lock, [&]{ return !freeBuffers.empty(); });
+    }
+
+    auto buffer = freeBuffers.back();
+    freeBuffers.pop_back();
+    acquireCounter.add();
+
+    return FrameRef(buffer);
+}
+
+void FramePool::release(FrameBuffer * buffer) {
+    std::unique_lock<std::mutex> lock(mutex);
+    freeBuffers.push_back(buffer);
+    lock.unlock();
+    conditionVar.notify_one();
+}
+
+}
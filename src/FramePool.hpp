@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include <opencv2/core.hpp>
+
+#include "Metrics.hpp"
+
+namespace tppocr {
+
+class FramePool;
+
+struct FrameBuffer {
+    unsigned int frameID = 0;
+    // Presentation time in seconds from the stream start
+    double streamTime = 0;
+    cv::Mat image;
+    cv::Mat grayImage;
+    cv::Mat debugImage;
+    // Region tasks of this frame that haven't finished yet
+    std::atomic<unsigned int> pendingTasks{0};
+    // Set when a region task of this frame was dropped from the work queue
+    // so its other regions are skipped
+    std::atomic<bool> dropped{false};
+    // Held while drawing on the debug image
+    std::mutex debugImageMutex;
+
+private:
+    friend class FramePool;
+    friend class FrameRef;
+
+    FramePool * pool = nullptr;
+    std::atomic<unsigned int> referenceCount{0};
+};
+
+// Reference counted handle to a FrameBuffer.
+//
+// The buffer is returned to its pool when the last handle is released.
+class FrameRef {
+    FrameBuffer * buffer = nullptr;
+
+public:
+    FrameRef() = default;
+    explicit FrameRef(FrameBuffer * buffer);
+    FrameRef(const FrameRef & other);
+    FrameRef(FrameRef && other) noexcept;
+    ~FrameRef();
+
+    FrameRef & operator=(const FrameRef & other);
+    FrameRef & operator=(FrameRef && other) noexcept;
+
+    FrameBuffer * get() const;
+    FrameBuffer * operator->() const;
+    FrameBuffer & operator*() const;
+    explicit operator bool() const;
+
+    void reset();
+};
+
+// Fixed set of preallocated frame buffers that are borrowed and returned
+// instead of allocating images for every frame.
+//
+// The frame-pool-allocations counter only covers the images of the pool,
+// which are all allocated here; frames are decoded into them in place.
+class FramePool {
+    std::vector<std::unique_ptr<FrameBuffer>> buffers;
+    std::vector<FrameBuffer*> freeBuffers;
+    std::mutex mutex;
+    std::condition_variable conditionVar;
+    Counter & allocationCounter;
+    Counter & acquireCounter;
+    Counter & waitCounter;
+
+public:
+    explicit FramePool(size_t capacity, int width, int height,
+        bool hasGrayImage, bool hasDebugImage, Metrics & metrics);
+
+    // Returns a free buffer, blocking until one is available
+    FrameRef acquire();
+
+private:
+    friend class FrameRef;
+
+    void release(FrameBuffer * buffer);
+    void allocateImage(cv::Mat & image, int width, int height, int type);
+};
+
+}
@@ -0,0 +1,56 @@
+#include "FrameRing.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace tppocr {
+
+FrameRing::FrameRing(size_t capacity) :
+    slots(capacity) {
+
+    if (capacity == 0) {
+        throw std::runtime_error("FrameRing capacity must not be zero");
+    }
+}
+
+bool FrameRing::push(FrameRef frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    conditionVar.wait(lock, [&]{ return closed || count < slots.size(); });
+
+    if (closed) {
+        return false;
+    }
+
+    slots[(readIndex + count) % slots.size()] = std::move(frame);
+    count += 1;
+    lock.unlock();
+    conditionVar.notify_all();
+
+    return true;
+}
+
+FrameRef FrameRing::pop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    conditionVar.wait(lock, [&]{ return closed || count > 0; });
+
+    if (count == 0) {
+        return FrameRef();
+    }
+
+    auto frame = std::move(slots[readIndex]);
+    readIndex = (readIndex + 1) % slots.size();
+    count -= 1;
+    lock.unlock();
+    conditionVar.notify_all();
+
+    return frame;
+}
+
+void FrameRing::close() {
+    std::unique_lock<std::mutex> lock(mutex);
+    closed = true;
+    lock.unlock();
+    conditionVar.notify_all();
+}
+
+}
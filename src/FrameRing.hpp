@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "FramePool.hpp"
+
+namespace tppocr {
+
+// Fixed number of decoded frames passed from the decode thread
+// to the main thread.
+class FrameRing {
+    std::vector<FrameRef> slots;
+    size_t readIndex = 0;
+    size_t count = 0;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable conditionVar;
+
+public:
+    explicit FrameRing(size_t capacity);
+
+    // Adds a frame, blocking while full. Returns false if closed.
+    bool push(FrameRef frame);
+    // Removes the oldest frame, blocking while empty. Returns an empty
+    // handle if closed and empty.
+    FrameRef pop();
+    void close();
+};
+
+}
@@ -0,0 +1,175 @@
+#include "GlyphAtlas.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <stdexcept>
+#include <mutex>
+#include <algorithm>
+
+namespace tppocr {
+
+bool GlyphAtlas::isEmpty() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return labels.empty();
+}
+
+bool GlyphAtlas::hasLabels(const std::vector<std::string> & characters) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+
+    return std::all_of(characters.begin(), characters.end(),
+        [this](const std::string & character) {
+            auto iterator = labelCounts.find(character);
+            return iterator != labelCounts.end() && iterator->second > 0;
+        });
+}
+
+void GlyphAtlas::match(const cv::Mat & samples,
+        std::vector<std::string> & matchLabels,
+        std::vector<float> & matchScores,
+        std::vector<float> & matchMargins) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+
+    matchLabels.assign(samples.rows, std::string());
+    matchScores.assign(samples.rows, 0);
+    matchMargins.assign(samples.rows, 0);
+
+    if (labels.empty() || samples.empty()) {
+        return;
+    }
+
+    // Rows are normalized so the dot products are the correlations
+    cv::Mat scores;
+    cv::gemm(samples, glyphs, 1, cv::noArray(), 0, scores, cv::GEMM_2_T);
+
+    for (int row = 0; row < scores.rows; row++) {
+        cv::Point maxLocation;
+        double maxScore;
+        cv::minMaxLoc(scores.row(row), nullptr, &maxScore, nullptr, &maxLocation);
+
+        auto & label = labels[maxLocation.x];
+        auto rowScores = scores.ptr<float>(row);
+        float otherScore = -1;
+
+        for (size_t index = 0; index < labels.size(); index++) {
+            if (labels[index] != label) {
+                otherScore = std::max(otherScore, rowScores[index]);
+            }
+        }
+
+        matchLabels[row] = label;
+        matchScores[row] = std::max(0.0, maxScore);
+        matchMargins[row] = maxScore - otherScore;
+    }
+}
+
+bool GlyphAtlas::add(const std::string & label, const cv::Mat & sample) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto & count = labelCounts[label];
+    auto row = sample.reshape(1, 1);
+
+    if (count < maxSamples) {
+        glyphs.push_back(row);
+        labels.push_back(label);
+        count += 1;
+
+        return true;
+    }
+
+    std::vector<int> rows;
+
+    for (size_t index = 0; index < labels.size(); index++) {
+        if (labels[index] == label) {
+            rows.push_back(index);
+        }
+    }
+
+    // Sum of the correlations of each candidate with the others; the
+    // new sample is the last candidate
+    std::vector<double> agreements(rows.size() + 1, 0);
+
+    for (size_t first = 0; first < agreements.size(); first++) {
+        auto firstRow = first < rows.size() ? glyphs.row(rows[first]) : row;
+
+        for (size_t second = first + 1; second < agreements.size(); second++) {
+            auto secondRow = second < rows.size() ? glyphs.row(rows[second]) : row;
+            double correlation = firstRow.dot(secondRow);
+
+            agreements[first] += correlation;
+            agreements[second] += correlation;
+        }
+    }
+
+    size_t worst = std::min_element(agreements.begin(), agreements.end())
+        - agreements.begin();
+
+    if (worst == rows.size()) {
+        return false;
+    }
+
+    row.copyTo(glyphs.row(rows[worst]));
+
+    return true;
+}
+
+// File format, one glyph per line:
+//   <character> <glyphSize * glyphSize values>
+void GlyphAtlas::load(const std::string & path) {
+    std::ifstream file(path);
+
+    if (!file) {
+        std::cerr << "Glyph atlas '" << path << "' not found" << std::endl;
+        return;
+    }
+
+    std::string lineString;
+    size_t count = 0;
+
+    while (std::getline(file, lineString)) {
+        std::istringstream lineStream(lineString);
+        std::string label;
+        cv::Mat sample(1, glyphSize * glyphSize, CV_32F);
+
+        lineStream >> label;
+
+        for (int index = 0; index < sample.cols; index++) {
+            lineStream >> sample.at<float>(index);
+        }
+
+        if (!lineStream) {
+            throw std::runtime_error("Malformed glyph atlas " + path);
+        }
+
+        count += add(label, sample);
+    }
+
+    std::cerr << "Loaded " << count << " glyphs from " << path << std::endl;
+}
+
+void GlyphAtlas::save(const std::string & path) const {
+    auto tempPath = path + ".tmp";
+    std::ofstream file(tempPath, std::ios::trunc);
+    std::shared_lock<std::shared_mutex> lock(mutex);
+
+    for (size_t row = 0; row < labels.size(); row++) {
+        file << labels[row];
+
+        auto values = glyphs.ptr<float>(row);
+
+        for (int index = 0; index < glyphs.cols; index++) {
+            file << ' ' << values[index];
+        }
+
+        file << '\n';
+    }
+
+    lock.unlock();
+    file.close();
+
+    if (!file || std::rename(tempPath.c_str(), path.c_str())) {
+        throw std::runtime_error("Failed to write glyph atlas " + path);
+    }
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <shared_mutex>
+
+#include <opencv2/core.hpp>
+
+namespace tppocr {
+
+// Normalized glyph images of a fixed font and their characters, learned
+// from recognized text.
+//
+// Shared by all workers.
+class GlyphAtlas {
+    // One zero mean, unit length glyph per row
+    cv::Mat glyphs;
+    std::vector<std::string> labels;
+    std::unordered_map<std::string,size_t> labelCounts;
+    mutable std::shared_mutex mutex;
+
+public:
+    // Glyphs are resized to this square before comparing
+    static constexpr int glyphSize = 16;
+    // Samples kept for each character
+    static constexpr size_t maxSamples = 4;
+
+    bool isEmpty() const;
+
+    // Whether every one of the characters has a sample
+    bool hasLabels(const std::vector<std::string> & characters) const;
+
+    // Matches each row of the normalized glyphs against the atlas, giving
+    // the best character, its correlation and how much lower the best
+    // correlation of any other character is
+    void match(const cv::Mat & samples, std::vector<std::string> & matchLabels,
+        std::vector<float> & matchScores, std::vector<float> & matchMargins) const;
+
+    // Once a character has all its samples, the one that agrees least
+    // with the others and the new sample is dropped, so an early mislabeled
+    // sample is replaced over time. Returns whether the sample was kept.
+    bool add(const std::string & label, const cv::Mat & sample);
+
+    void load(const std::string & path);
+    void save(const std::string & path) const;
+};
+
+typedef std::unordered_map<std::string,std::shared_ptr<GlyphAtlas>> GlyphAtlases;
+
+}
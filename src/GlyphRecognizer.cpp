@@ -0,0 +1,234 @@
+#include "GlyphRecognizer.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#include <opencv2/imgproc.hpp>
+
+#include "imageutil.hpp"
+
+namespace tppocr {
+
+namespace {
+
+// Splits UTF-8 text into characters, leaving out spaces
+std::vector<std::string> splitCharacters(const std::string & text) {
+    std::vector<std::string> characters;
+
+    for (size_t index = 0; index < text.size();) {
+        auto byte = static_cast<unsigned char>(text[index]);
+        size_t length = byte < 0x80 ? 1 : byte < 0xE0 ? 2 : byte < 0xF0 ? 3 : 4;
+
+        if (!std::isspace(byte)) {
+            characters.push_back(text.substr(index, length));
+        }
+
+        index += length;
+    }
+
+    return characters;
+}
+
+}
+
+GlyphRecognizer::GlyphRecognizer(const Region & region,
+        std::shared_ptr<GlyphAtlas> atlas, Metrics & metrics) :
+    region(region),
+    atlas(atlas),
+    whitelistCharacters(splitCharacters(region.recognizerWhitelist)),
+    hitCounter(metrics.counter("recognizer-glyph-hits")),
+    missCounter(metrics.counter("recognizer-glyph-misses")),
+    learnCounter(metrics.counter("recognizer-glyph-learned")),
+    timer(metrics.timer("recognizer-glyph")) {}
+
+bool GlyphRecognizer::processImage(const cv::Mat & image, OCRResult & result) {
+    cv::TickMeter tickMeter;
+    tickMeter.start();
+
+    // Segmented even if not matched since learn() uses the glyphs
+    segment(image);
+
+    // Until every character that can appear has been learned, a glyph
+    // missing from the atlas would be read as its closest known one
+    if (!isAtlasComplete) {
+        isAtlasComplete = atlas->hasLabels(whitelistCharacters);
+
+        if (!isAtlasComplete) {
+            missCounter.add();
+            tickMeter.stop();
+            timer.add(tickMeter.getTimeSec());
+            return false;
+        }
+    }
+
+    atlas->match(samples, matchLabels, matchScores, matchMargins);
+
+    bool isConfident = !glyphBoxes.empty();
+
+    for (size_t index = 0; isConfident && index < glyphBoxes.size(); index++) {
+        // Similar glyphs such as '3' and '8' must also be told apart
+        isConfident = matchScores[index] >= region.recognizerGlyphThreshold
+            && matchMargins[index] >= region.recognizerGlyphMargin;
+    }
+
+    if (isConfident) {
+        buildResult(result);
+        hitCounter.add();
+    } else {
+        missCounter.add();
+    }
+
+    tickMeter.stop();
+    timer.add(tickMeter.getTimeSec());
+
+    return isConfident;
+}
+
+void GlyphRecognizer::learn(const OCRResult & result, float confidenceThreshold) {
+    if (result.meanConfidence < confidenceThreshold || result.lines.size() != 1) {
+        return;
+    }
+
+    auto characters = splitCharacters(result.lines.front().text);
+
+    // Touching or broken glyphs can't be told apart by position
+    if (characters.size() != glyphBoxes.size()) {
+        return;
+    }
+
+    for (size_t index = 0; index < characters.size(); index++) {
+        if (atlas->add(characters[index], samples.row(index))) {
+            learnCounter.add();
+        }
+    }
+}
+
+void GlyphRecognizer::segment(const cv::Mat & image) {
+    binarizeText(image, grayImage, binaryImage);
+
+    int count = cv::connectedComponentsWithStats(binaryImage, labels, stats,
+        centroids, 8, CV_32S);
+
+    glyphBoxes.clear();
+
+    for (int label = 1; label < count; label++) {
+        cv::Rect box(
+            stats.at<int>(label, cv::CC_STAT_LEFT),
+            stats.at<int>(label, cv::CC_STAT_TOP),
+            stats.at<int>(label, cv::CC_STAT_WIDTH),
+            stats.at<int>(label, cv::CC_STAT_HEIGHT)
+        );
+
+        // Block borders rather than glyphs
+        if (box.height >= binaryImage.rows - 1 || box.width >= binaryImage.cols - 1) {
+            continue;
+        }
+
+        glyphBoxes.push_back(box);
+    }
+
+    std::sort(glyphBoxes.begin(), glyphBoxes.end(),
+        [](const cv::Rect & a, const cv::Rect & b) { return a.x < b.x; });
+
+    // Join parts of the same glyph, such as the dots of a colon
+    size_t joinedCount = 0;
+
+    for (auto & box : glyphBoxes) {
+        if (joinedCount > 0) {
+            auto & previous = glyphBoxes[joinedCount - 1];
+
+            if (box.x < previous.x + previous.width) {
+                previous |= box;
+                continue;
+            }
+        }
+
+        glyphBoxes[joinedCount++] = box;
+    }
+
+    glyphBoxes.resize(joinedCount);
+
+    int top = binaryImage.rows;
+    int bottom = 0;
+
+    for (auto & box : glyphBoxes) {
+        top = std::min(top, box.y);
+        bottom = std::max(bottom, box.y + box.height);
+    }
+
+    const int size = GlyphAtlas::glyphSize;
+    samples.create(glyphBoxes.size(), size * size, CV_32F);
+
+    for (size_t index = 0; index < glyphBoxes.size(); index++) {
+        auto & box = glyphBoxes[index];
+
+        // Use the height of the whole line so the position within the
+        // line tells apart glyphs such as '-' and '_'
+        box.y = top;
+        box.height = bottom - top;
+
+        cv::resize(binaryImage(box), glyphImage, cv::Size(size, size), 0, 0, cv::INTER_AREA);
+
+        auto sample = samples.row(index);
+        glyphImage.reshape(1, 1).convertTo(sample, CV_32F);
+        sample -= cv::mean(sample)[0];
+
+        double norm = cv::norm(sample);
+
+        if (norm > 0) {
+            sample /= norm;
+        }
+    }
+}
+
+void GlyphRecognizer::buildResult(OCRResult & result) {
+    result = OCRResult();
+
+    OCRLine line;
+    OCRWord word;
+    float confidenceSum = 0;
+    float wordConfidenceSum = 0;
+
+    auto finishWord = [&]() {
+        word.confidence = wordConfidenceSum / word.symbols.size();
+        line.words.push_back(std::move(word));
+        word = OCRWord();
+        wordConfidenceSum = 0;
+    };
+
+    for (size_t index = 0; index < glyphBoxes.size(); index++) {
+        auto & box = glyphBoxes[index];
+
+        if (index > 0) {
+            auto & previous = glyphBoxes[index - 1];
+
+            if (box.x - (previous.x + previous.width) > box.height * spaceRatio) {
+                finishWord();
+                line.text += ' ';
+            }
+        }
+
+        OCRSymbol symbol;
+        symbol.text = matchLabels[index];
+        symbol.box = box;
+        symbol.confidence = matchScores[index];
+
+        word.text += symbol.text;
+        word.box |= box;
+        wordConfidenceSum += symbol.confidence;
+        confidenceSum += symbol.confidence;
+        line.text += symbol.text;
+        line.box |= box;
+
+        word.symbols.push_back(std::move(symbol));
+    }
+
+    finishWord();
+
+    line.confidence = confidenceSum / glyphBoxes.size();
+    result.meanConfidence = line.confidence;
+    result.text = line.text + '\n';
+    result.lines.push_back(std::move(line));
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <opencv2/core.hpp>
+
+#include "Region.hpp"
+#include "GlyphAtlas.hpp"
+#include "OCR.hpp"
+#include "Metrics.hpp"
+
+namespace tppocr {
+
+// Recognizes a single line of a fixed font by segmenting glyphs and
+// matching them against a glyph atlas.
+//
+// Glyphs are learned from confident Tesseract results of the same
+// region, so the atlas fills in while the region falls back to Tesseract.
+class GlyphRecognizer {
+    const Region & region;
+    std::shared_ptr<GlyphAtlas> atlas;
+    cv::Mat grayImage;
+    cv::Mat binaryImage;
+    cv::Mat labels;
+    cv::Mat stats;
+    cv::Mat centroids;
+    cv::Mat glyphImage;
+    std::vector<cv::Rect> glyphBoxes;
+    // Normalized glyphs of the last image, one per row
+    cv::Mat samples;
+    std::vector<std::string> matchLabels;
+    std::vector<float> matchScores;
+    std::vector<float> matchMargins;
+    // Characters of the region's whitelist, all needed in the atlas first
+    std::vector<std::string> whitelistCharacters;
+    bool isAtlasComplete = false;
+    Counter & hitCounter;
+    Counter & missCounter;
+    Counter & learnCounter;
+    Timer & timer;
+
+public:
+    // Gap between glyphs relative to the line height that is a space
+    static constexpr float spaceRatio = 0.5f;
+
+    explicit GlyphRecognizer(const Region & region,
+        std::shared_ptr<GlyphAtlas> atlas, Metrics & metrics);
+
+    // Returns false if any glyph isn't matched confidently enough, in
+    // which case the image should be given to Tesseract and then learn()
+    bool processImage(const cv::Mat & image, OCRResult & result);
+
+    // Adds the glyphs of the last image using a Tesseract result of it
+    void learn(const OCRResult & result, float confidenceThreshold);
+
+private:
+    void segment(const cv::Mat & image);
+    void buildResult(OCRResult & result);
+};
+
+}
@@ -2,10 +2,13 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
 
 namespace tppocr {
 
-InputStream::InputStream(std::shared_ptr<Config> config) {
+InputStream::InputStream(std::shared_ptr<Config> config) :
+        config(config),
+        skipNonReferenceFrames(config->decoderSkipNonReferenceFrames) {
     formatContext = avformat_alloc_context();
 
     if (!formatContext) {
@@ -45,6 +48,9 @@ InputStream::InputStream(std::shared_ptr<Config> config) {
 }
 
 InputStream::~InputStream() {
+    sws_freeContext(regionScalerContext);
+    sws_freeContext(scalerContext);
+
     if (formatContext != nullptr) {
         avformat_free_context(formatContext);
     }
@@ -92,48 +98,39 @@ void InputStream::findVideoStream() {
         "avcodec_parameters_to_context failed"
     );
 
+    videoCodecContext->thread_count = config->decoderThreads;
+
+    if (config->decoderThreadType == "frame") {
+        videoCodecContext->thread_type = FF_THREAD_FRAME;
+    } else if (config->decoderThreadType == "slice") {
+        videoCodecContext->thread_type = FF_THREAD_SLICE;
+    } else if (config->decoderThreadType == "frame+slice") {
+        videoCodecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    } else {
+        throw std::runtime_error("Unknown decoder thread type " + config->decoderThreadType);
+    }
+
     checkError(
         avcodec_open2(videoCodecContext, videoCodec, nullptr),
         "avcodec_open2 failed"
     );
 
-    auto frameRate = av_guess_frame_rate(formatContext, formatContext->streams[videoStreamIndex], nullptr);
+    frameRate = av_guess_frame_rate(formatContext, formatContext->streams[videoStreamIndex], nullptr);
     fps_ = static_cast<double>(frameRate.num) / frameRate.den;
 
-    std::cerr << "video fps: " << fps_ << std::endl;
+    std::cerr << "video fps: " << fps_ << " "
+        << "decoder threads: " << videoCodecContext->thread_count << std::endl;
 }
 
 void InputStream::createVideoBuffers() {
     videoWidth = videoCodecContext->width;
     videoHeight = videoCodecContext->height;
 
-    frameBGR = av_frame_alloc();
-
-    if (!frameBGR) {
-        throw std::runtime_error("av_frame_alloc failed (bgr)");
-    }
-
-    frameBGR->width = videoWidth;
-    frameBGR->height = videoHeight;
-
-    const int align = 32;
-
-    auto size = av_image_get_buffer_size(AV_PIX_FMT_BGR24, videoWidth, videoHeight, align);
-    frameBGRBuffer = static_cast<uint8_t*>(av_malloc(size));
-
-    if (!frameBGRBuffer) {
-        throw std::runtime_error("av_malloc failed (frameBGRBuffer)");
-    }
-
-    av_image_fill_arrays(frameBGR->data, frameBGR->linesize,
-        frameBGRBuffer, AV_PIX_FMT_BGR24,
-        frameBGR->width, frameBGR->height, align);
-
     scalerContext = sws_getContext(
         videoCodecContext->width,
         videoCodecContext->height,
         videoCodecContext->pix_fmt,
-        frameBGR->width, frameBGR->height, AV_PIX_FMT_BGR24,
+        videoWidth, videoHeight, AV_PIX_FMT_BGR24,
         SWS_FAST_BILINEAR, nullptr, nullptr, nullptr
     );
 }
@@ -142,6 +139,10 @@ unsigned int InputStream::frameCounter() {
     return frameCounter_;
 }
 
+double InputStream::frameTime() {
+    return frameTime_;
+}
+
 bool InputStream::isRunning() {
     return running;
 }
@@ -154,14 +155,76 @@ unsigned int InputStream::videoFrameHeight() {
     return videoHeight;
 }
 
-uint8_t * InputStream::videoFrameData() {
-    return frameBGRBuffer;
+uint8_t * InputStream::videoFrameLumaData() {
+    auto descriptor = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+
+    if (!descriptor || (descriptor->flags & AV_PIX_FMT_FLAG_RGB)
+            || (descriptor->flags & AV_PIX_FMT_FLAG_PAL)
+            || (descriptor->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+        return nullptr;
+    }
+
+    auto & component = descriptor->comp[0];
+
+    if (component.plane != 0 || component.step != 1 || component.depth != 8) {
+        return nullptr;
+    }
+
+    return frame->data[0] + component.offset;
+}
+
+int InputStream::videoFrameLumaLineSize() {
+    return frame->linesize[0];
 }
 
 double InputStream::fps() {
     return fps_;
 }
 
+void InputStream::setFrameInterval(unsigned int interval) {
+    frameInterval = std::max(interval, 1u);
+}
+
+int64_t InputStream::timestampToFrameIndex(int64_t timestamp) {
+    if (timestamp == AV_NOPTS_VALUE || frameRate.num <= 0) {
+        return -1;
+    }
+
+    auto stream = formatContext->streams[videoStreamIndex];
+    auto startTime = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+
+    return av_rescale_q(timestamp - startTime, stream->time_base, av_inv_q(frameRate));
+}
+
+double InputStream::timestampToSeconds(int64_t timestamp, int64_t frameIndex) {
+    if (timestamp == AV_NOPTS_VALUE) {
+        return fps_ > 0 ? frameIndex / fps_ : 0;
+    }
+
+    auto stream = formatContext->streams[videoStreamIndex];
+    auto startTime = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+
+    return (timestamp - startTime) * av_q2d(stream->time_base);
+}
+
+bool InputStream::isPacketNeeded(const AVPacket * packet) {
+    if (packet->flags & AV_PKT_FLAG_KEY) {
+        return true;
+    }
+
+    auto frameIndex = timestampToFrameIndex(packet->pts);
+
+    // Without a timestamp, we can't tell which frame it is so decode it
+    return frameIndex < 0 || isSampleFrameIndex(frameIndex);
+}
+
+bool InputStream::isSampleFrameIndex(int64_t frameIndex) {
+    // Timestamps going backwards (such as a restarted stream) are
+    // treated as a new sample so the schedule can resync
+    return frameIndex >= nextSampleFrameIndex
+        || frameIndex < nextSampleFrameIndex - frameInterval;
+}
+
 void InputStream::runOnce() {
     auto errorCode = av_read_frame(formatContext, packet);
 
@@ -171,13 +234,21 @@ void InputStream::runOnce() {
     }
 
     if (packet->stream_index != videoStreamIndex) {
+        av_packet_unref(packet);
         return;
     }
 
-    checkError(
-        avcodec_send_packet(videoCodecContext, packet),
-        "avcodec_send_packet failed"
-    );
+    if (skipNonReferenceFrames) {
+        // Frames before the next sample are never shown to the callback,
+        // so let the decoder drop them unless other frames depend on them.
+        videoCodecContext->skip_frame = isPacketNeeded(packet) ?
+            AVDISCARD_DEFAULT : AVDISCARD_NONREF;
+    }
+
+    errorCode = avcodec_send_packet(videoCodecContext, packet);
+    av_packet_unref(packet);
+
+    checkError(errorCode, "avcodec_send_packet failed");
 
     while (true) {
         errorCode = avcodec_receive_frame(videoCodecContext, frame);
@@ -188,14 +259,91 @@ void InputStream::runOnce() {
             throw std::runtime_error("avcodec_receive_frame failed");
         }
 
+        auto frameIndex = timestampToFrameIndex(frame->best_effort_timestamp);
+
+        if (frameIndex < 0) {
+            frameIndex = decodedFrameCounter;
+        }
+
+        decodedFrameCounter++;
+
+        if (!isSampleFrameIndex(frameIndex)) {
+            continue;
+        }
+
+        frameCounter_ = static_cast<unsigned int>(frameIndex);
+        frameTime_ = timestampToSeconds(frame->best_effort_timestamp, frameIndex);
+        nextSampleFrameIndex = frameIndex + frameInterval;
+
         callback();
-        frameCounter_++;
     }
 }
 
-void InputStream::convertFrameToBGR() {
+void InputStream::convertFrameToBGR(uint8_t * data, int lineSize) {
+    uint8_t * destinationData[AV_NUM_DATA_POINTERS] = {data};
+    int destinationLineSize[AV_NUM_DATA_POINTERS] = {lineSize};
+
     sws_scale(scalerContext, frame->data, frame->linesize, 0, frame->height,
-        frameBGR->data, frameBGR->linesize);
+        destinationData, destinationLineSize);
+}
+
+void InputStream::convertFrameRegionToBGR(int x, int y, int width, int height,
+        uint8_t * data, int lineSize) {
+    auto pixelFormat = static_cast<AVPixelFormat>(frame->format);
+    auto descriptor = av_pix_fmt_desc_get(pixelFormat);
+
+    // Cropping by offsetting the plane pointers only works for planar formats
+    // decoded into system memory
+    if (!descriptor || !(descriptor->flags & AV_PIX_FMT_FLAG_PLANAR)
+            || (descriptor->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+        convertFrameToBGR(data, lineSize);
+        return;
+    }
+
+    // Snap to the chroma grid so the subsampled planes line up
+    const int alignX = 1 << descriptor->log2_chroma_w;
+    const int alignY = 1 << descriptor->log2_chroma_h;
+    int left = std::max(x, 0) / alignX * alignX;
+    int top = std::max(y, 0) / alignY * alignY;
+    int right = std::min((x + width + alignX - 1) / alignX * alignX,
+        static_cast<int>(videoWidth));
+    int bottom = std::min((y + height + alignY - 1) / alignY * alignY,
+        static_cast<int>(videoHeight));
+
+    if (right <= left || bottom <= top) {
+        return;
+    }
+
+    regionScalerContext = sws_getCachedContext(regionScalerContext,
+        right - left, bottom - top, pixelFormat,
+        right - left, bottom - top, AV_PIX_FMT_BGR24,
+        SWS_FAST_BILINEAR, nullptr, nullptr, nullptr
+    );
+
+    if (!regionScalerContext) {
+        throw std::runtime_error("sws_getCachedContext failed (region)");
+    }
+
+    const uint8_t * sourceData[AV_NUM_DATA_POINTERS] = {};
+
+    for (int index = 0; index < descriptor->nb_components; index++) {
+        auto & component = descriptor->comp[index];
+        bool isChroma = (index == 1 || index == 2)
+            && !(descriptor->flags & AV_PIX_FMT_FLAG_RGB);
+        int planeX = isChroma ? left >> descriptor->log2_chroma_w : left;
+        int planeY = isChroma ? top >> descriptor->log2_chroma_h : top;
+
+        sourceData[component.plane] = frame->data[component.plane]
+            + planeY * frame->linesize[component.plane]
+            + planeX * component.step;
+    }
+
+    uint8_t * destinationData[AV_NUM_DATA_POINTERS] = {
+        data + top * lineSize + left * 3};
+    int destinationLineSize[AV_NUM_DATA_POINTERS] = {lineSize};
+
+    sws_scale(regionScalerContext, sourceData, frame->linesize,
+        0, bottom - top, destinationData, destinationLineSize);
 }
 
 }
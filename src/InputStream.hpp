@@ -12,6 +12,7 @@ extern "C" {
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 }
 
 #include "Config.hpp"
@@ -19,6 +20,7 @@ extern "C" {
 namespace tppocr {
 
 class InputStream {
+    std::shared_ptr<Config> config;
     AVFormatContext * formatContext = nullptr;
     AVCodec * videoCodec = nullptr;
     AVCodecParameters * videoCodecParameters = nullptr;
@@ -28,11 +30,16 @@ class InputStream {
     int videoStreamIndex = std::numeric_limits<unsigned int>::max();
     unsigned int videoWidth = 0;
     unsigned int videoHeight = 0;
-    AVFrame * frameBGR = nullptr;
-    uint8_t * frameBGRBuffer = nullptr;
     SwsContext * scalerContext = nullptr;
+    SwsContext * regionScalerContext = nullptr;
+    AVRational frameRate = {0, 1};
     double fps_ = 0;
     unsigned int frameCounter_ = 0;
+    double frameTime_ = 0;
+    unsigned int decodedFrameCounter = 0;
+    unsigned int frameInterval = 1;
+    int64_t nextSampleFrameIndex = 0;
+    bool skipNonReferenceFrames = false;
 
     bool running = false;
 
@@ -43,19 +50,34 @@ public:
     ~InputStream();
 
     unsigned int frameCounter();
+    // Presentation time of the decoded frame in seconds from the stream start
+    double frameTime();
     bool isRunning();
     unsigned int videoFrameWidth();
     unsigned int videoFrameHeight();
-    uint8_t * videoFrameData();
+    // Luma plane of the decoded frame or nullptr if it doesn't have an 8-bit one
+    uint8_t * videoFrameLumaData();
+    int videoFrameLumaLineSize();
     double fps();
 
+    // Only frames spaced this many frames apart are passed to the callback
+    void setFrameInterval(unsigned int interval);
+
     void runOnce();
-    void convertFrameToBGR();
+    // Converts the frame into a caller owned BGR24 image of the frame size
+    void convertFrameToBGR(uint8_t * data, int lineSize);
+    // Converts only the given rectangle into the same place in the BGR image
+    void convertFrameRegionToBGR(int x, int y, int width, int height,
+        uint8_t * data, int lineSize);
 
 private:
     void checkError(int errorCode, const std::string errorMessage);
     void findVideoStream();
     void createVideoBuffers();
+    int64_t timestampToFrameIndex(int64_t timestamp);
+    double timestampToSeconds(int64_t timestamp, int64_t frameIndex);
+    bool isPacketNeeded(const AVPacket * packet);
+    bool isSampleFrameIndex(int64_t frameIndex);
 };
 
 }
@@ -0,0 +1,116 @@
+#include "LineRecognizerPool.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+namespace tppocr {
+
+LineRecognizerPool::LineRecognizerPool(std::shared_ptr<Config> config, Metrics & metrics) :
+    config(config),
+    metrics(metrics) {
+
+    size_t count = 0;
+
+    for (auto & region : config->regions) {
+        if (region.recognizerLineMode) {
+            count = std::max(count, region.recognizerLineInstances);
+        }
+    }
+
+    if (!count) {
+        return;
+    }
+
+    count = std::min<size_t>(count, std::max(std::thread::hardware_concurrency(), 1u));
+
+    std::cerr << "Line recognizer instances: " << count << std::endl;
+
+    for (size_t index = 0; index < count; index++) {
+        threads.emplace_back(&LineRecognizerPool::recognizerEntry, this);
+    }
+}
+
+LineRecognizerPool::~LineRecognizerPool() {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+    lock.unlock();
+    jobConditionVar.notify_all();
+
+    for (auto & thread : threads) {
+        thread.join();
+    }
+}
+
+void LineRecognizerPool::processLines(const Region & region, const cv::Mat & image,
+        const std::vector<cv::Rect> & lines, std::vector<OCRResult> & results) {
+    results.resize(lines.size());
+
+    if (lines.empty()) {
+        return;
+    }
+
+    Request request = {lines.size(), nullptr};
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (size_t index = 0; index < lines.size(); index++) {
+        pendingJobs.push_back(Job{&region, image(lines[index]), &results[index], &request});
+    }
+
+    jobConditionVar.notify_all();
+    doneConditionVar.wait(lock, [&]{ return request.remaining == 0; });
+    lock.unlock();
+
+    if (request.error) {
+        std::rethrow_exception(request.error);
+    }
+}
+
+void LineRecognizerPool::recognizerEntry() {
+    // Tesseract instances aren't thread safe so each thread has its own
+    std::unordered_map<std::string,std::unique_ptr<OCR>> recognizers;
+
+    for (auto & region : config->regions) {
+        if (region.recognizerLineMode) {
+            recognizers.emplace(region.name,
+                std::make_unique<OCR>(config, region, metrics, true));
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        jobConditionVar.wait(lock, [&]{ return stopping || !pendingJobs.empty(); });
+
+        if (stopping) {
+            break;
+        }
+
+        auto job = pendingJobs.front();
+        pendingJobs.pop_front();
+        lock.unlock();
+
+        std::exception_ptr error;
+
+        try {
+            *job.result = recognizers.at(job.region->name)->processImage(job.image);
+        } catch (...) {
+            // Given to the waiting worker instead of ending the process
+            error = std::current_exception();
+        }
+
+        lock.lock();
+
+        if (error && !job.request->error) {
+            job.request->error = error;
+        }
+
+        job.request->remaining -= 1;
+
+        if (job.request->remaining == 0) {
+            doneConditionVar.notify_all();
+        }
+    }
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <opencv2/core.hpp>
+
+#include "Config.hpp"
+#include "Metrics.hpp"
+#include "OCR.hpp"
+
+namespace tppocr {
+
+// Single line recognizers shared by all workers for regions in line mode.
+//
+// A fixed number of threads, at most the number of cores, each with its
+// own recognizer for every line mode region, take lines from a common
+// queue so the lines of a block are read concurrently without starting
+// threads for each block.
+class LineRecognizerPool {
+    struct Request {
+        size_t remaining;
+        std::exception_ptr error;
+    };
+
+    struct Job {
+        const Region * region;
+        cv::Mat image;
+        OCRResult * result;
+        Request * request;
+    };
+
+    std::shared_ptr<Config> config;
+    Metrics & metrics;
+    std::vector<std::thread> threads;
+    std::deque<Job> pendingJobs;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable jobConditionVar;
+    std::condition_variable doneConditionVar;
+
+public:
+    explicit LineRecognizerPool(std::shared_ptr<Config> config, Metrics & metrics);
+    ~LineRecognizerPool();
+
+    // Recognizes each line of the image and blocks until all are done.
+    // An error recognizing any line is rethrown here.
+    void processLines(const Region & region, const cv::Mat & image,
+        const std::vector<cv::Rect> & lines, std::vector<OCRResult> & results);
+
+private:
+    void recognizerEntry();
+};
+
+}
@@ -0,0 +1,72 @@
+#include "Metrics.hpp"
+
+namespace tppocr {
+
+void Counter::add(uint64_t amount) {
+    value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+void Counter::set(uint64_t newValue) {
+    value.store(newValue, std::memory_order_relaxed);
+}
+
+uint64_t Counter::get() const {
+    return value.load(std::memory_order_relaxed);
+}
+
+void Timer::add(double seconds) {
+    count.fetch_add(1, std::memory_order_relaxed);
+    nanoseconds.fetch_add(static_cast<uint64_t>(seconds * 1e9),
+        std::memory_order_relaxed);
+}
+
+uint64_t Timer::getCount() const {
+    return count.load(std::memory_order_relaxed);
+}
+
+double Timer::getTotalSeconds() const {
+    return nanoseconds.load(std::memory_order_relaxed) / 1e9;
+}
+
+Counter & Metrics::counter(const std::string & name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto & item = counters[name];
+
+    if (!item) {
+        item = std::make_unique<Counter>();
+    }
+
+    return *item;
+}
+
+Timer & Metrics::timer(const std::string & name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto & item = timers[name];
+
+    if (!item) {
+        item = std::make_unique<Timer>();
+    }
+
+    return *item;
+}
+
+void Metrics::print(std::ostream & stream) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto & item : counters) {
+        stream << "Metric " << item.first << ": " << item.second->get() << "\n";
+    }
+
+    for (auto & item : timers) {
+        auto count = item.second->getCount();
+        auto total = item.second->getTotalSeconds();
+
+        stream << "Metric " << item.first << ": count " << count
+            << " total " << total << " s"
+            << " mean " << (count ? total / count : 0) << " s\n";
+    }
+
+    stream.flush();
+}
+
+}
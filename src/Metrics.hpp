@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+
+namespace tppocr {
+
+class Counter {
+    std::atomic<uint64_t> value{0};
+
+public:
+    void add(uint64_t amount = 1);
+    void set(uint64_t newValue);
+    uint64_t get() const;
+};
+
+class Timer {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> nanoseconds{0};
+
+public:
+    void add(double seconds);
+    uint64_t getCount() const;
+    double getTotalSeconds() const;
+};
+
+// Named counters and timers shared between threads.
+//
+// Look up a metric once and keep the reference; updating it afterwards
+// is lock-free and doesn't allocate.
+class Metrics {
+    std::mutex mutex;
+    std::map<std::string,std::unique_ptr<Counter>> counters;
+    std::map<std::string,std::unique_ptr<Timer>> timers;
+
+public:
+    Counter & counter(const std::string & name);
+    Timer & timer(const std::string & name);
+
+    void print(std::ostream & stream);
+};
+
+}
@@ -1,112 +1,311 @@
 #include "OCR.hpp"
 
 #include <stdexcept>
-#include <assert.h>
+#include <utility>
+#include <fstream>
+#include <sstream>
 
 #include <leptonica/allheaders.h>
 #include <tesseract/genericvector.h>
+#include <tesseract/resultiterator.h>
+#include <opencv2/imgproc.hpp>
+
+#include "imageutil.hpp"
 
 namespace tppocr {
 
-OCR::OCR(std::shared_ptr<Config> config, const Region & region) {
-    tesseract.reset(new tesseract::TessBaseAPI());
+OCR::OCR(std::shared_ptr<Config> config, const Region & region,
+        Metrics & metrics, bool singleLine) :
+    config(config),
+    region(region),
+    singleLine(singleLine),
+    blockCounter(metrics.counter("recognizer-blocks")),
+    escalationCounter(metrics.counter("recognizer-escalations")),
+    escalationWinCounter(metrics.counter("recognizer-escalations-improved")),
+    fastHitCounter(metrics.counter("recognizer-fast-hits")),
+    bestRunCounter(metrics.counter("recognizer-best-runs")),
+    bestHitCounter(metrics.counter("recognizer-best-hits")),
+    fastTimer(metrics.timer("recognizer-fast")),
+    fallbackTimer(metrics.timer("recognizer-fallback")),
+    bestTimer(metrics.timer("recognizer-best")) {}
+
+TesseractPtr OCR::load(const std::string & tessdataPath,
+        const std::string & languages) {
+    // Language models are only loaded once a region has text to recognize
+    TesseractPtr tesseract(new tesseract::TessBaseAPI());
 
     GenericVector<STRING> initKeys;
     GenericVector<STRING> initValues;
 
+    initKeys.push_back("user_defined_dpi");
+    initValues.push_back("90");
+
     if (!region.patternFilename.empty()) {
         initKeys.push_back("user_patterns_file");
         initValues.push_back(region.patternFilename.c_str());
     }
 
+    if (!region.recognizerWhitelist.empty()) {
+        initKeys.push_back("tessedit_char_whitelist");
+        initValues.push_back(region.recognizerWhitelist.c_str());
+    }
+
+    // Passed to Init() so that init-only variables such as dictionary
+    // loading take effect
+    for (auto & variable : region.recognizerVariables) {
+        initKeys.push_back(variable.first.c_str());
+        initValues.push_back(variable.second.c_str());
+    }
+
+    auto engineMode = tesseract::OEM_LSTM_ONLY;
+
+    switch (region.recognizerEngine) {
+    case TextRecognizerEngine::LSTM:
+        engineMode = tesseract::OEM_LSTM_ONLY;
+        break;
+    case TextRecognizerEngine::Legacy:
+        engineMode = tesseract::OEM_TESSERACT_ONLY;
+        break;
+    case TextRecognizerEngine::Combined:
+        engineMode = tesseract::OEM_TESSERACT_LSTM_COMBINED;
+        break;
+    }
+
     auto errorCode = tesseract->Init(
-        config->tessdataPath.c_str(),
-        "eng+jpn+chi_sim+chi_tra+kor+spa+deu+ita",
-        tesseract::OEM_LSTM_ONLY,
+        tessdataPath.c_str(),
+        languages.c_str(),
+        engineMode,
         nullptr, 0,
         &initKeys, &initValues, false
     );
 
     if (errorCode) {
-        throw std::runtime_error("Tesseract error " + std::to_string(errorCode));
+        throw std::runtime_error("Tesseract error " + std::to_string(errorCode)
+            + " loading '" + languages + "' from '" + tessdataPath
+            + "' for region " + region.name);
+    }
+
+    if (singleLine) {
+        tesseract->SetPageSegMode(tesseract::PSM_SINGLE_LINE);
+    } else if (region.recognizerPageSegMode >= 0) {
+        tesseract->SetPageSegMode(
+            static_cast<tesseract::PageSegMode>(region.recognizerPageSegMode));
     }
 
     // tesseract->SetVariable("classify_enable_learning", "0");
-    tesseract->SetVariable("user_defined_dpi", "90");
+
+    return tesseract;
 }
 
-const std::string & OCR::getText() {
+namespace {
+
+std::string takeText(char * cText) {
+    std::string text = cText ? cText : "";
+    delete [] cText;
     return text;
 }
 
-float OCR::getMeanConfidence() {
-    return meanConfidence;
+cv::Rect getBoundingBox(const tesseract::ResultIterator & iterator,
+        tesseract::PageIteratorLevel level) {
+    int left, top, right, bottom;
+
+    if (!iterator.BoundingBox(level, &left, &top, &right, &bottom)) {
+        return cv::Rect();
+    }
+
+    return cv::Rect(left, top, right - left, bottom - top);
+}
+
 }
 
-void OCR::processImage(const cv::Mat & image) {
-    auto pix = pixCreate(image.cols, image.rows, 32);
+namespace {
+
+void checkLanguageFiles(const std::string & tessdataPath,
+        const std::string & languages, const std::string & regionName) {
+    // Without a path Tesseract searches its own default locations
+    if (tessdataPath.empty()) {
+        return;
+    }
+
+    std::istringstream stream(languages);
+    std::string language;
 
-    assert(pix);
+    while (std::getline(stream, language, '+')) {
+        auto path = tessdataPath + "/" + language + ".traineddata";
 
-    for (int heightIndex = 0; heightIndex < image.rows; heightIndex++) {
-        for (int widthIndex = 0; widthIndex < image.cols; widthIndex++) {
-            // The byte ordering is probably wrong??
-            auto & vec = image.at<cv::Vec3b>(heightIndex, widthIndex);
-            uint32_t pixValue = (vec[0] << 16) | (vec[1] << 8) | (vec[2] << 0);
-            auto errorCode = pixSetPixel(pix, widthIndex, heightIndex, pixValue);
-            assert(!errorCode);
+        if (language.empty() || !std::ifstream(path)) {
+            throw std::runtime_error("Missing trained data " + path
+                + " for region " + regionName);
         }
     }
+}
 
-    tesseract->SetImage(pix);
-    pixDestroy(&pix);
+}
 
-    auto cText = tesseract->GetUTF8Text();
-    text = std::string(cText);
-    delete cText;
+void OCR::checkTrainedData(const Config & config, const Region & region) {
+    checkLanguageFiles(config.tessdataPath, region.recognizerLanguages, region.name);
+    checkLanguageFiles(config.tessdataPath, region.recognizerFallbackLanguages, region.name);
 
-    meanConfidence = tesseract->MeanTextConf() / 100.0;
+    if (region.recognizerBestTier && !config.tessdataBestPath.empty()) {
+        checkLanguageFiles(config.tessdataBestPath, region.recognizerLanguages, region.name);
+        checkLanguageFiles(config.tessdataBestPath, region.recognizerFallbackLanguages, region.name);
+    }
 }
 
-cv::Mat OCR::getThresholdedImage() {
-    auto pixThresholdedImage = tesseract->GetThresholdedImage();
-    const auto width = pixGetWidth(pixThresholdedImage);
-    const auto height = pixGetHeight(pixThresholdedImage);
-    auto thresholdedImage = cv::Mat(height, width, CV_8UC3);
+tesseract::TessBaseAPI & OCR::getEngine(const std::string & tessdataPath,
+        const std::string & languages) {
+    for (auto & engine : engines) {
+        if (engine.tessdataPath == tessdataPath && engine.languages == languages) {
+            return *engine.tesseract;
+        }
+    }
+
+    engines.push_back(Engine{tessdataPath, languages, load(tessdataPath, languages)});
+
+    return *engines.back().tesseract;
+}
+
+bool OCR::isConfident(const OCRResult & result) const {
+    return result.meanConfidence >= region.recognizerFallbackThreshold;
+}
+
+OCRResult OCR::processImage(const cv::Mat & image, cv::Mat * thresholdedImage) {
+    blockCounter.add();
+
+    OCRResult result;
+    cv::TickMeter tickMeter;
+    tickMeter.start();
 
-    for (int heightIndex = 0; heightIndex < height; heightIndex++) {
-        for (int widthIndex = 0; widthIndex < width; widthIndex++) {
-            uint32_t pixel;
-            pixGetPixel(pixThresholdedImage, widthIndex, heightIndex, &pixel);
+    // Engine that produced the kept result
+    auto tesseract = &getEngine(config->tessdataPath, region.recognizerLanguages);
+    setTesseractImage(*tesseract, image, rgbImage);
+    recognize(*tesseract, result);
+    auto languages = &region.recognizerLanguages;
 
-            uint8_t value = pixel ? 255 : 0;
+    tickMeter.stop();
+    fastTimer.add(tickMeter.getTimeSec());
 
-            auto & vec = thresholdedImage.at<cv::Vec3b>(heightIndex, widthIndex);
-            vec[0] = value;
-            vec[1] = value;
-            vec[2] = value;
+    if (!isConfident(result) && !region.recognizerFallbackLanguages.empty()) {
+        // Most text is in the primary languages so the expensive combined
+        // models only run on the few blocks the primary ones can't read
+        tickMeter.reset();
+        tickMeter.start();
+        escalationCounter.add();
+
+        auto & fallback = getEngine(config->tessdataPath, region.recognizerFallbackLanguages);
+
+        if (retry(fallback, image, result)) {
+            escalationWinCounter.add();
+            tesseract = &fallback;
+            languages = &region.recognizerFallbackLanguages;
         }
+
+        tickMeter.stop();
+        fallbackTimer.add(tickMeter.getTimeSec());
     }
 
+    if (isConfident(result)) {
+        fastHitCounter.add();
+    } else if (region.recognizerBestTier && !config->tessdataBestPath.empty()) {
+        tickMeter.reset();
+        tickMeter.start();
+        bestRunCounter.add();
 
-    pixDestroy(&pixThresholdedImage);
+        auto & best = getEngine(config->tessdataBestPath, *languages);
+
+        if (retry(best, image, result)) {
+            tesseract = &best;
+        }
+
+        if (isConfident(result)) {
+            bestHitCounter.add();
+        }
+
+        tickMeter.stop();
+        bestTimer.add(tickMeter.getTimeSec());
+    }
+
+    if (thresholdedImage) {
+        // Taken now while the engine still holds this image
+        getThresholdedImage(*tesseract, *thresholdedImage);
+    }
+
+    return result;
+}
+
+// Recognizes again and keeps the new result if it is more confident
+bool OCR::retry(tesseract::TessBaseAPI & api, const cv::Mat & image,
+        OCRResult & result) {
+    setTesseractImage(api, image, rgbImage);
+    recognize(api, retryResult);
+
+    if (retryResult.meanConfidence > result.meanConfidence) {
+        std::swap(result, retryResult);
+        return true;
+    }
 
-    return thresholdedImage;
+    return false;
 }
 
-std::vector<cv::Rect> OCR::getLineBoundaries() {
-    std::vector<cv::Rect> lineBoundaries;
+void OCR::recognize(tesseract::TessBaseAPI & api, OCRResult & result) {
+    result = OCRResult();
 
-    Pixa * pixArray;
-    int * blockIDs;
-    Boxa * boxArray = tesseract->GetTextlines(&pixArray, &blockIDs);
+    if (api.Recognize(nullptr)) {
+        return;
+    }
+
+    std::unique_ptr<tesseract::ResultIterator> iterator(api.GetIterator());
 
-    for (int32_t index = 0; index < boxArray->n; index++) {
-        Box * box = boxArray->box[index];
-        lineBoundaries.emplace_back(box->x, box->y, box->w, box->h);
+    if (!iterator || iterator->Empty(tesseract::RIL_WORD)) {
+        return;
     }
 
-    return lineBoundaries;
+    // Collect everything in one pass over the recognized words instead of
+    // asking Tesseract again for each kind of result
+    float confidenceSum = 0;
+    size_t wordCount = 0;
+
+    do {
+        if (iterator->IsAtBeginningOf(tesseract::RIL_TEXTLINE) || result.lines.empty()) {
+            OCRLine line;
+            line.text = takeText(iterator->GetUTF8Text(tesseract::RIL_TEXTLINE));
+
+            while (!line.text.empty() && line.text.back() == '\n') {
+                line.text.pop_back();
+            }
+
+            line.box = getBoundingBox(*iterator, tesseract::RIL_TEXTLINE);
+            line.confidence = iterator->Confidence(tesseract::RIL_TEXTLINE) / 100.0f;
+            result.lines.push_back(std::move(line));
+        }
+
+        OCRWord word;
+        word.text = takeText(iterator->GetUTF8Text(tesseract::RIL_WORD));
+        word.box = getBoundingBox(*iterator, tesseract::RIL_WORD);
+        word.confidence = iterator->Confidence(tesseract::RIL_WORD) / 100.0f;
+
+        confidenceSum += word.confidence;
+        wordCount += 1;
+
+        result.lines.back().words.push_back(std::move(word));
+    } while (iterator->Next(tesseract::RIL_WORD));
+
+    for (auto & line : result.lines) {
+        result.text += line.text;
+        result.text += '\n';
+    }
+
+    // Same as MeanTextConf(), which averages the word confidences
+    result.meanConfidence = confidenceSum / wordCount;
+}
+
+void OCR::getThresholdedImage(tesseract::TessBaseAPI & api, cv::Mat & image) {
+    auto pixThresholdedImage = api.GetThresholdedImage();
+
+    convertPixToMat(pixThresholdedImage, image);
+    cv::cvtColor(image, image, cv::COLOR_GRAY2BGR);
+
+    pixDestroy(&pixThresholdedImage);
 }
 
 }
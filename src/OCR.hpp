@@ -8,6 +8,7 @@
 #include <opencv2/core.hpp>
 
 #include "Config.hpp"
+#include "Metrics.hpp"
 
 namespace tppocr {
 
@@ -19,21 +20,85 @@ public:
     }
 };
 
-class OCR {
-    std::unique_ptr<tesseract::TessBaseAPI,TesseractDeleter> tesseract;
+// Single character, only filled in by the glyph recognizer
+struct OCRSymbol {
+    std::string text;
+    cv::Rect box;
+    float confidence = 0; // [0.0, 1.0]
+};
+
+struct OCRWord {
     std::string text;
-    float meanConfidence = 0;
+    cv::Rect box;
+    float confidence = 0; // [0.0, 1.0]
+    std::vector<OCRSymbol> symbols;
+};
+
+struct OCRLine {
+    std::string text;
+    cv::Rect box;
+    float confidence = 0; // [0.0, 1.0]
+    std::vector<OCRWord> words;
+};
+
+// Recognized text of an image. Boxes are relative to the image.
+struct OCRResult {
+    std::string text;
+    float meanConfidence = 0; // [0.0, 1.0]
+    std::vector<OCRLine> lines;
+};
+
+typedef std::unique_ptr<tesseract::TessBaseAPI,TesseractDeleter> TesseractPtr;
+
+// Recognizes text with the region's languages and, while the result
+// confidence is below the region's fallback threshold, retries with the
+// fallback languages and then with the best (slow) trained data.
+class OCR {
+    struct Engine {
+        std::string tessdataPath;
+        std::string languages;
+        TesseractPtr tesseract;
+    };
+
+    std::shared_ptr<Config> config;
+    const Region & region;
+    bool singleLine;
+    std::vector<Engine> engines;
+    OCRResult retryResult;
+    cv::Mat rgbImage;
+    Counter & blockCounter;
+    Counter & escalationCounter;
+    Counter & escalationWinCounter;
+    Counter & fastHitCounter;
+    Counter & bestRunCounter;
+    Counter & bestHitCounter;
+    Timer & fastTimer;
+    Timer & fallbackTimer;
+    Timer & bestTimer;
 
 public:
-    explicit OCR(std::shared_ptr<Config> config, const Region & region);
+    // Single line recognizers override the region's page segmentation mode
+    explicit OCR(std::shared_ptr<Config> config, const Region & region,
+        Metrics & metrics, bool singleLine = false);
 
-    const std::string & getText();
-    float getMeanConfidence();
+    // Throws if the trained data file of any language the region may use
+    // is missing, so a bad config fails at startup instead of on a worker
+    // thread once the models are loaded
+    static void checkTrainedData(const Config & config, const Region & region);
 
-    void processImage(const cv::Mat & image);
+    // If given, the thresholded image is set to Tesseract's binarized
+    // image of the kept result, as BGR
+    OCRResult processImage(const cv::Mat & image, cv::Mat * thresholdedImage = nullptr);
 
-    cv::Mat getThresholdedImage();
-    std::vector<cv::Rect> getLineBoundaries();
+private:
+    TesseractPtr load(const std::string & tessdataPath, const std::string & languages);
+    tesseract::TessBaseAPI & getEngine(const std::string & tessdataPath,
+        const std::string & languages);
+    bool isConfident(const OCRResult & result) const;
+    bool retry(tesseract::TessBaseAPI & api, const cv::Mat & image,
+        OCRResult & result);
+    void recognize(tesseract::TessBaseAPI & api, OCRResult & result);
+    void getThresholdedImage(tesseract::TessBaseAPI & api, cv::Mat & image);
 };
 
 
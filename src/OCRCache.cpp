@@ -0,0 +1,223 @@
+#include "OCRCache.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+namespace tppocr {
+
+namespace {
+
+const uint64_t fnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t fnvPrime = 1099511628211ULL;
+// First line of cache files, changed whenever keys are computed differently
+const char * fileVersion = "tppocr-ocr-cache 2";
+// Mean ink of a cell is reduced to this many bits
+const int signatureBits = 3;
+
+uint64_t hashBytes(uint64_t hash, const uint8_t * data, size_t length) {
+    for (size_t index = 0; index < length; index++) {
+        hash ^= data[index];
+        hash *= fnvPrime;
+    }
+
+    return hash;
+}
+
+}
+
+OCRCache::OCRCache(size_t capacity, Metrics & metrics) :
+    capacity(capacity),
+    hitCounter(metrics.counter("recognizer-cache-hits")),
+    missCounter(metrics.counter("recognizer-cache-misses")),
+    sizeCounter(metrics.counter("recognizer-cache-size")) {}
+
+bool OCRCache::isEnabled() const {
+    return capacity > 0;
+}
+
+uint64_t OCRCache::computeKey(const std::string & regionName,
+        const cv::Mat & image, cv::Mat & workImage, cv::Mat & signatureImage) {
+    if (image.channels() == 1) {
+        cv::threshold(image, workImage, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+    } else {
+        cv::cvtColor(image, workImage, cv::COLOR_BGR2GRAY);
+        cv::threshold(workImage, workImage, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+    }
+
+    auto hash = hashBytes(fnvOffsetBasis,
+        reinterpret_cast<const uint8_t*>(regionName.data()), regionName.size());
+
+    int32_t blockSize[2] = {image.cols, image.rows};
+    hash = hashBytes(hash, reinterpret_cast<const uint8_t*>(blockSize), sizeof(blockSize));
+
+    // Inverted so text is usually the foreground
+    cv::Rect inkRect = cv::boundingRect(workImage);
+
+    if (inkRect.empty()) {
+        return hash;
+    }
+
+    cv::Size signatureSize(
+        std::max(1, (inkRect.width + cellSize / 2) / cellSize),
+        std::max(1, (inkRect.height + cellSize / 2) / cellSize)
+    );
+    cv::resize(workImage(inkRect), signatureImage, signatureSize, 0, 0, cv::INTER_AREA);
+
+    int32_t size[2] = {signatureImage.cols, signatureImage.rows};
+    hash = hashBytes(hash, reinterpret_cast<const uint8_t*>(size), sizeof(size));
+
+    for (int row = 0; row < signatureImage.rows; row++) {
+        auto pixels = signatureImage.ptr<uint8_t>(row);
+
+        for (int col = 0; col < signatureImage.cols; col++) {
+            uint8_t level = pixels[col] >> (8 - signatureBits);
+            hash = hashBytes(hash, &level, 1);
+        }
+    }
+
+    return hash;
+}
+
+bool OCRCache::get(uint64_t key, const cv::Size & blockSize, OCRResult & result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iterator = index.find(key);
+
+    // The size is hashed too but a colliding key must not return boxes
+    // for a different block
+    if (iterator == index.end() || iterator->second->blockSize != blockSize) {
+        missCounter.add();
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, iterator->second);
+    result = iterator->second->result;
+    hitCounter.add();
+
+    return true;
+}
+
+void OCRCache::put(uint64_t key, const cv::Size & blockSize, const OCRResult & result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    insert(key, blockSize, result);
+}
+
+void OCRCache::insert(uint64_t key, const cv::Size & blockSize, const OCRResult & result) {
+    auto iterator = index.find(key);
+
+    if (iterator != index.end()) {
+        iterator->second->blockSize = blockSize;
+        iterator->second->result = result;
+        entries.splice(entries.begin(), entries, iterator->second);
+        return;
+    }
+
+    entries.push_front(Entry{key, blockSize, result});
+    index[key] = entries.begin();
+
+    if (entries.size() > capacity) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+
+    sizeCounter.set(entries.size());
+}
+
+// File format, a version line and then one entry after another, least
+// recently used first:
+//   <key> <block width> <block height> <mean confidence> <line count>
+//   <x> <y> <width> <height> <confidence> <text>   (once per line)
+void OCRCache::load(const std::string & path) {
+    std::ifstream file(path);
+
+    if (!file) {
+        std::cerr << "OCR cache file '" << path << "' not found" << std::endl;
+        return;
+    }
+
+    std::string header;
+
+    if (!std::getline(file, header) || header != fileVersion) {
+        // Keys from another version would never be hit
+        std::cerr << "Ignoring OCR cache file '" << path
+            << "' from an older version" << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    while (std::getline(file, header)) {
+        uint64_t key;
+        cv::Size blockSize;
+        OCRResult result;
+        size_t lineCount;
+        std::istringstream headerStream(header);
+
+        if (!(headerStream >> std::hex >> key >> std::dec
+                >> blockSize.width >> blockSize.height
+                >> result.meanConfidence >> lineCount)) {
+            throw std::runtime_error("Malformed OCR cache file " + path);
+        }
+
+        for (size_t lineIndex = 0; lineIndex < lineCount; lineIndex++) {
+            OCRLine line;
+            std::string lineString;
+
+            if (!std::getline(file, lineString)) {
+                throw std::runtime_error("Truncated OCR cache file " + path);
+            }
+
+            std::istringstream lineStream(lineString);
+            lineStream >> line.box.x >> line.box.y
+                >> line.box.width >> line.box.height >> line.confidence;
+            lineStream.get();
+            std::getline(lineStream, line.text);
+
+            result.text += line.text;
+            result.text += '\n';
+            result.lines.push_back(std::move(line));
+        }
+
+        insert(key, blockSize, result);
+    }
+
+    std::cerr << "Loaded " << entries.size() << " OCR cache entries" << std::endl;
+}
+
+void OCRCache::save(const std::string & path) {
+    // Replace the old file only once the new one is complete
+    auto tempPath = path + ".tmp";
+    std::ofstream file(tempPath, std::ios::trunc);
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    file << fileVersion << '\n';
+
+    for (auto entry = entries.rbegin(); entry != entries.rend(); entry++) {
+        auto & result = entry->result;
+
+        file << std::hex << entry->key << std::dec << ' '
+            << entry->blockSize.width << ' ' << entry->blockSize.height << ' '
+            << result.meanConfidence << ' ' << result.lines.size() << '\n';
+
+        for (auto & line : result.lines) {
+            file << line.box.x << ' ' << line.box.y << ' '
+                << line.box.width << ' ' << line.box.height << ' '
+                << line.confidence << ' ' << line.text << '\n';
+        }
+    }
+
+    lock.unlock();
+    file.close();
+
+    if (!file || std::rename(tempPath.c_str(), path.c_str())) {
+        throw std::runtime_error("Failed to write OCR cache file " + path);
+    }
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <stdint.h>
+
+#include <opencv2/core.hpp>
+
+#include "OCR.hpp"
+#include "Metrics.hpp"
+
+namespace tppocr {
+
+// Least recently used cache of recognition results keyed by a coarse
+// signature of the binarized text block.
+//
+// Shared by all workers.
+class OCRCache {
+    struct Entry {
+        uint64_t key;
+        // Line boxes of the result are relative to a block of this size
+        cv::Size blockSize;
+        OCRResult result;
+    };
+
+    size_t capacity;
+    std::list<Entry> entries;
+    std::unordered_map<uint64_t,std::list<Entry>::iterator> index;
+    std::mutex mutex;
+    Counter & hitCounter;
+    Counter & missCounter;
+    Counter & sizeCounter;
+
+public:
+    explicit OCRCache(size_t capacity, Metrics & metrics);
+
+    bool isEnabled() const;
+
+    // Size of the square cells the ink of a block is averaged over
+    static const int cellSize = 4;
+
+    // Hashes the text block binarized with Otsu's method, cropped to its
+    // dark pixels and averaged into coarse quantized cells, so small shifts
+    // of the detected box and single noisy pixels don't matter. The size
+    // of the block is part of the key. The work images are reused between
+    // calls.
+    static uint64_t computeKey(const std::string & regionName,
+        const cv::Mat & image, cv::Mat & workImage, cv::Mat & signatureImage);
+
+    bool get(uint64_t key, const cv::Size & blockSize, OCRResult & result);
+    void put(uint64_t key, const cv::Size & blockSize, const OCRResult & result);
+
+    // Words are not saved, only lines, their boxes and confidences
+    void load(const std::string & path);
+    void save(const std::string & path);
+
+private:
+    void insert(uint64_t key, const cv::Size & blockSize, const OCRResult & result);
+};
+
+}
@@ -0,0 +1,137 @@
+#include "ProjectionTextDetector.hpp"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+#include "imageutil.hpp"
+
+namespace tppocr {
+
+ProjectionTextDetector::ProjectionTextDetector(Metrics & metrics) :
+    timer(metrics.timer("detector-projection")) {}
+
+void ProjectionTextDetector::processImage(const cv::Mat & image,
+        TextDetections & result) {
+    cv::TickMeter tickMeter;
+    tickMeter.start();
+
+    result.detections.clear();
+    result.confidences.clear();
+    result.indices.clear();
+
+    binarize(image);
+    removeNonGlyphs();
+    findLines(result);
+
+    tickMeter.stop();
+    timer.add(tickMeter.getTimeSec());
+}
+
+void ProjectionTextDetector::binarize(const cv::Mat & image) {
+    binarizeText(image, grayImage, binaryImage);
+}
+
+void ProjectionTextDetector::removeNonGlyphs() {
+    int count = cv::connectedComponentsWithStats(binaryImage, labels, stats,
+        centroids, 8, CV_32S);
+
+    std::vector<uchar> isGlyph(count, 0);
+
+    // Label 0 is the background
+    for (int label = 1; label < count; label++) {
+        int width = stats.at<int>(label, cv::CC_STAT_WIDTH);
+        int height = stats.at<int>(label, cv::CC_STAT_HEIGHT);
+
+        // Small dots such as periods are kept if they share a row with
+        // other glyphs, which the row profile takes care of
+        isGlyph[label] = height <= maxGlyphHeight
+            && width <= std::max(height, minGlyphHeight) * maxGlyphAspect;
+    }
+
+    glyphImage.create(binaryImage.size(), CV_8UC1);
+
+    for (int row = 0; row < labels.rows; row++) {
+        auto labelRow = labels.ptr<int>(row);
+        auto glyphRow = glyphImage.ptr<uchar>(row);
+
+        for (int column = 0; column < labels.cols; column++) {
+            glyphRow[column] = isGlyph[labelRow[column]] ? 1 : 0;
+        }
+    }
+}
+
+void ProjectionTextDetector::findLines(TextDetections & result) {
+    cv::reduce(glyphImage, rowProfile, 1, cv::REDUCE_SUM, CV_32S);
+
+    int top = -1;
+    int gap = 0;
+
+    for (int row = 0; row <= rowProfile.rows; row++) {
+        bool hasInk = row < rowProfile.rows && rowProfile.at<int>(row) > 0;
+
+        if (hasInk) {
+            if (top < 0) {
+                top = row;
+            }
+            gap = 0;
+        } else if (top >= 0) {
+            gap += 1;
+
+            if (gap > maxRowGap || row == rowProfile.rows) {
+                int bottom = row - gap + 1;
+
+                if (bottom - top >= minGlyphHeight) {
+                    findLineSegments(top, bottom, result);
+                }
+
+                top = -1;
+                gap = 0;
+            }
+        }
+    }
+}
+
+void ProjectionTextDetector::findLineSegments(int top, int bottom,
+        TextDetections & result) {
+    cv::reduce(glyphImage.rowRange(top, bottom), columnProfile, 0,
+        cv::REDUCE_SUM, CV_32S);
+
+    int height = bottom - top;
+    int maxGap = std::max(1, static_cast<int>(height * maxColumnGapRatio));
+    int left = -1;
+    int right = -1;
+    auto profile = columnProfile.ptr<int>(0);
+
+    auto addSegment = [&]() {
+        cv::Rect box(left, top, right - left, height);
+        result.detections.emplace_back(
+            cv::Point2f(box.x + box.width / 2.0f, box.y + box.height / 2.0f),
+            cv::Size2f(box.width, box.height), 0.0f);
+        result.confidences.push_back(1.0f);
+        result.indices.push_back(result.detections.size() - 1);
+    };
+
+    for (int column = 0; column < columnProfile.cols; column++) {
+        if (profile[column] == 0) {
+            continue;
+        }
+
+        if (left >= 0 && column - right > maxGap) {
+            addSegment();
+            left = -1;
+        }
+
+        if (left < 0) {
+            left = column;
+        }
+
+        right = column + 1;
+    }
+
+    if (left >= 0) {
+        addSegment();
+    }
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include "TextDetector.hpp"
+#include "Metrics.hpp"
+
+namespace tppocr {
+
+// Finds horizontal lines of text on a flat background using projection
+// profiles of the binarized image.
+//
+// Much cheaper than the EAST detector but only suits axis aligned UI text.
+class ProjectionTextDetector {
+    cv::Mat grayImage;
+    cv::Mat binaryImage;
+    cv::Mat glyphImage;
+    cv::Mat labels;
+    cv::Mat stats;
+    cv::Mat centroids;
+    cv::Mat rowProfile;
+    cv::Mat columnProfile;
+    Timer & timer;
+
+public:
+    // Glyph components smaller or larger than these are ignored
+    static constexpr int minGlyphHeight = 4;
+    static constexpr int maxGlyphHeight = 64;
+    // Widest component relative to its height, to ignore borders
+    static constexpr int maxGlyphAspect = 8;
+    // Blank rows joined into a line, for accents and descenders
+    static constexpr int maxRowGap = 2;
+    // Blank columns relative to the line height that split a line
+    static constexpr float maxColumnGapRatio = 2.0f;
+
+    explicit ProjectionTextDetector(Metrics & metrics);
+
+    // Detects text lines in the BGR image
+    void processImage(const cv::Mat & image, TextDetections & result);
+
+private:
+    void binarize(const cv::Mat & image);
+    void removeNonGlyphs();
+    void findLines(TextDetections & result);
+    void findLineSegments(int top, int bottom, TextDetections & result);
+};
+
+}
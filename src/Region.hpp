@@ -1,9 +1,56 @@
 #pragma once
 
 #include <string>
+#include <array>
+#include <vector>
+#include <utility>
+#include <cmath>
+#include <algorithm>
 
 namespace tppocr {
 
+// Cheap test whether a region may contain text before running the detector
+struct RegionPrefilter {
+    enum class Type {
+        // Fraction of Canny edge pixels
+        EdgeDensity,
+        // Fraction of pixels within a color range
+        ColorFraction,
+        // Best normalized correlation with a template image
+        Template
+    };
+
+    Type type = Type::EdgeDensity;
+    std::string name;
+    // Smallest value of the measure for the region to pass
+    float minimum = 0;
+    // Inclusive RGB range for ColorFraction
+    std::array<int,3> lowerColor{{0, 0, 0}};
+    std::array<int,3> upperColor{{255, 255, 255}};
+    std::string templateFilename;
+};
+
+enum class TextDetectorType {
+    // EAST neural network, handles any text
+    EAST,
+    // Projection profiles, for horizontal text on a flat background
+    Projection
+};
+
+enum class TextRecognizerType {
+    Tesseract,
+    // Glyph atlas matching, for a single line of a fixed font
+    Glyph
+};
+
+enum class TextRecognizerEngine {
+    LSTM,
+    // The following need trained data that includes the legacy models,
+    // which tessdata_fast and tessdata_best don't
+    Legacy,
+    Combined
+};
+
 struct Region {
     std::string name;
     int x = 0;
@@ -11,7 +58,64 @@ struct Region {
     int width = 0;
     int height = 0;
     bool alwaysHasText = false;
+    // If specified, the region shows the wall clock in this strftime
+    // format and is only read to keep the clock model in sync
+    std::string clockFormat;
     std::string patternFilename;
+    TextRecognizerType recognizerType = TextRecognizerType::Tesseract;
+    // Where the learned glyphs are loaded from and saved to (optional)
+    std::string recognizerGlyphAtlasFilename;
+    // Least correlation of every glyph to use the glyph recognizer result
+    float recognizerGlyphThreshold = 0.85;
+    // Least difference between the best correlation and the best one of
+    // any other character to use the glyph recognizer result
+    float recognizerGlyphMargin = 0.1;
+    // Tesseract language models, joined with '+'
+    std::string recognizerLanguages = "eng+jpn+chi_sim+chi_tra+kor+spa+deu+ita";
+    // Tesseract page segmentation mode or -1 for the library default
+    int recognizerPageSegMode = -1;
+    TextRecognizerEngine recognizerEngine = TextRecognizerEngine::LSTM;
+    // Languages to retry with when the result confidence is below the
+    // fallback threshold. Empty disables the retry.
+    std::string recognizerFallbackLanguages;
+    float recognizerFallbackThreshold = 0.7;
+    // Whether to retry results still below the fallback threshold with
+    // the best trained data
+    bool recognizerBestTier = false;
+    // Whether to only recognize the lines that changed since the last
+    // result. Requires change detection.
+    bool recognizerIncremental = false;
+    // Whether to recognize each detected line separately and concurrently
+    bool recognizerLineMode = false;
+    // Threads of the line recognizer pool shared by all workers. The pool
+    // uses the largest value of any region, at most the core count.
+    size_t recognizerLineInstances = 4;
+    std::string recognizerWhitelist;
+    // Extra Tesseract variables as name and value pairs
+    std::vector<std::pair<std::string,std::string>> recognizerVariables;
+    // Factor the region is resized by before running the text detector
+    float detectorScale = 1.0;
+    TextDetectorType detectorType = TextDetectorType::EAST;
+    // Run the text detector every this many processed frames and reuse
+    // the last text block in between
+    int detectorInterval = 1;
+    // Largest difference in levels of any averaged cell for the region to
+    // count as unchanged and reuse the previous result. Negative disables.
+    float changeTolerance = -1;
+    // All must pass for the text detector to run
+    std::vector<RegionPrefilter> prefilters;
+
+    bool usesEASTDetector() const {
+        return !alwaysHasText && detectorType == TextDetectorType::EAST;
+    }
+
+    int detectorWidth() const {
+        return std::max(1, static_cast<int>(std::lround(width * detectorScale)));
+    }
+
+    int detectorHeight() const {
+        return std::max(1, static_cast<int>(std::lround(height * detectorScale)));
+    }
 };
 
 }
@@ -0,0 +1,86 @@
+#include "RegionChangeDetector.hpp"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+namespace tppocr {
+
+RegionChangeDetector::RegionChangeDetector(const Region & region) :
+    region(region) {}
+
+bool RegionChangeDetector::isEnabled() const {
+    return region.changeTolerance >= 0;
+}
+
+void RegionChangeDetector::computeSignature(const cv::Mat & regionImage,
+        cv::Mat & signature) {
+    cv::Size size(
+        std::max(1, regionImage.cols / cellSize),
+        std::max(1, regionImage.rows / cellSize)
+    );
+
+    cv::resize(regionImage, signature, size, 0, 0, cv::INTER_AREA);
+}
+
+bool RegionChangeDetector::isSimilar(const cv::Mat & signature,
+        const cv::Mat & otherSignature) const {
+    if (signature.size() != otherSignature.size()
+            || signature.type() != otherSignature.type()) {
+        return false;
+    }
+
+    // Largest difference of any cell, rather than the mean, so a single
+    // changed character in a large region isn't averaged away
+    return cv::norm(signature, otherSignature, cv::NORM_INF) <= region.changeTolerance;
+}
+
+bool RegionChangeDetector::getUnchangedResult(const cv::Mat & signature,
+        RegionResult & result) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (reference.empty() || !isSimilar(signature, reference)) {
+        return false;
+    }
+
+    result = this->result;
+
+    return true;
+}
+
+bool RegionChangeDetector::getLastResult(RegionResult & result,
+        cv::Mat & textBlockImage) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (reference.empty() || !hasTextBlockImage) {
+        return false;
+    }
+
+    result = this->result;
+    // Deep copy since the stored buffer is overwritten by the next update
+    this->textBlockImage.copyTo(textBlockImage);
+
+    return true;
+}
+
+void RegionChangeDetector::update(const cv::Mat & signature,
+        unsigned int frameID, const RegionResult & result,
+        const cv::Mat & textBlockImage) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Workers may finish frames out of order
+    if (!reference.empty() && frameID < referenceFrameID) {
+        return;
+    }
+
+    signature.copyTo(reference);
+    referenceFrameID = frameID;
+    this->result = result;
+    hasTextBlockImage = !textBlockImage.empty();
+
+    if (hasTextBlockImage) {
+        textBlockImage.copyTo(this->textBlockImage);
+    }
+}
+
+}
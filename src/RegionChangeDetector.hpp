@@ -0,0 +1,71 @@
+#pragma once
+
+#include <mutex>
+
+#include <opencv2/core.hpp>
+
+#include "Region.hpp"
+#include "OCR.hpp"
+
+namespace tppocr {
+
+// Outcome of processing a region
+struct RegionResult {
+    bool hasText = false;
+    // Whether the result was copied from an earlier frame
+    bool isReused = false;
+    // Presentation time of the frame and the wall clock time modeled
+    // from it, if known
+    double streamTime = 0;
+    bool hasWallTime = false;
+    double wallTime = 0;
+    // Text block in frame coordinates
+    cv::Rect textBlock;
+    OCRResult ocrResult;
+};
+
+// Remembers the last processed pixels and result of a region so
+// unchanged samples can skip detection and recognition.
+//
+// Shared by all workers.
+class RegionChangeDetector {
+    const Region & region;
+    std::mutex mutex;
+    cv::Mat reference;
+    unsigned int referenceFrameID = 0;
+    RegionResult result;
+    // Pixels of the result's text block, only kept for incremental
+    // recognition. Reused across updates since blocks rarely change size.
+    cv::Mat textBlockImage;
+    bool hasTextBlockImage = false;
+
+public:
+    // Side length in pixels of the cells averaged into the signature
+    static constexpr int cellSize = 4;
+
+    explicit RegionChangeDetector(const Region & region);
+
+    bool isEnabled() const;
+
+    // Downsamples the region so compression noise averages out
+    void computeSignature(const cv::Mat & regionImage, cv::Mat & signature);
+
+    // Whether no cell of the signatures differs by more than the region's
+    // change tolerance
+    bool isSimilar(const cv::Mat & signature, const cv::Mat & otherSignature) const;
+
+    // Copies the last result if its signature is similar
+    bool getUnchangedResult(const cv::Mat & signature, RegionResult & result);
+
+    // Copies the last result and the pixels of its text block regardless
+    // of the current pixels. Fails if no text block pixels were stored.
+    bool getLastResult(RegionResult & result, cv::Mat & textBlockImage);
+
+    // Stores the result, and the text block pixels if given, unless a
+    // later frame was already stored
+    void update(const cv::Mat & signature, unsigned int frameID,
+        const RegionResult & result,
+        const cv::Mat & textBlockImage = cv::Mat());
+};
+
+}
@@ -1,11 +1,61 @@
 #include "TextDetector.hpp"
 
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
 
 namespace tppocr {
 
-TextDetector::TextDetector(std::shared_ptr<Config> config) {
-    network = cv::dnn::readNet(config->detectorModelPath);
+namespace {
+
+std::vector<uchar> readFile(const std::string & path) {
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file) {
+        throw std::runtime_error("Failed to open detector model " + path);
+    }
+
+    return std::vector<uchar>(std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>());
+}
+
+bool hasExtension(const std::string & path, const std::string & extension) {
+    return path.size() >= extension.size()
+        && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+}
+
+TextDetectorModel TextDetectorModel::read(const std::string & path) {
+    TextDetectorModel result;
+
+    if (hasExtension(path, ".pb")) {
+        result.framework = "tensorflow";
+        result.model = readFile(path);
+    } else if (hasExtension(path, ".onnx")) {
+        result.framework = "onnx";
+        result.model = readFile(path);
+    } else if (hasExtension(path, ".xml") || hasExtension(path, ".bin")) {
+        // Model Optimizer output is a description and a weights file
+        auto basePath = path.substr(0, path.size() - 4);
+        result.framework = "dldt";
+        result.model = readFile(basePath + ".bin");
+        result.config = readFile(basePath + ".xml");
+    } else {
+        throw std::runtime_error("Unknown detector model format " + path
+            + " (expected .pb, .onnx, .xml or .bin)");
+    }
+
+    return result;
+}
+
+TextDetector::TextDetector(std::shared_ptr<Config> config,
+        const TextDetectorModel & model, Metrics & metrics) :
+    confidenceMinimumThreshold(config->detectorConfidenceThreshold),
+    nonmaximumSuppressionThreshold(config->detectorNonmaximumSuppressionThreshold),
+    decodeTimer(metrics.timer("detector-decode")) {
+    network = cv::dnn::readNet(model.framework, model.model, model.config);
 
     if (config->preferInference) {
         std::cerr << "Set network backend preference to Intel Inference Engine" << std::endl;
@@ -28,90 +78,42 @@ TextDetector::TextDetector(std::shared_ptr<Config> config) {
     outputBlobNames.push_back("feature_fusion/concat_3");
 }
 
-const std::vector<cv::RotatedRect> & TextDetector::getDetections() {
-    return detections;
-}
-
-const std::vector<float> & TextDetector::getConfidences() {
-    return confidences;
-}
-
-const std::vector<int> & TextDetector::getIndices() {
-    return indices;
-}
-
+void TextDetector::processImages(const std::vector<cv::Mat> & images,
+        const std::vector<TextDetections*> & results) {
+    CV_Assert(!images.empty());
+    CV_Assert(images.size() == results.size());
 
-void TextDetector::processImage(const cv::Mat & image) {
     outputBlobs.clear();
     blob = cv::Mat();
 
     // Magic values copied from sample
-    cv::dnn::blobFromImage(image, blob, 1.0,
-        cv::Size(image.cols, image.rows),
+    cv::dnn::blobFromImages(images, blob, 1.0,
+        cv::Size(images[0].cols, images[0].rows),
         cv::Scalar(123.68, 116.78, 103.94),
         true, false);
 
     network.setInput(blob);
     network.forward(outputBlobs, outputBlobNames);
 
-    auto & scores = outputBlobs[0];
-    auto & geometry = outputBlobs[1];
-
-    detections.clear();
-    confidences.clear();
-    indices.clear();
-
-    // -------
-    // Rest of code mostly copied from sample.
-
-    CV_Assert(scores.dims == 4);
-    CV_Assert(geometry.dims == 4);
-    CV_Assert(scores.size[0] == 1);
-    CV_Assert(geometry.size[0] == 1);
-    CV_Assert(scores.size[1] == 1);
-    CV_Assert(geometry.size[1] == 5);
-    CV_Assert(scores.size[2] == geometry.size[2]);
-    CV_Assert(scores.size[3] == geometry.size[3]);
-
-    const int height = scores.size[2];
-    const int width = scores.size[3];
-
-    for (int y = 0; y < height; ++y) {
-        const float* scoresData = scores.ptr<float>(0, 0, y);
-        const float* x0_data = geometry.ptr<float>(0, 0, y);
-        const float* x1_data = geometry.ptr<float>(0, 1, y);
-        const float* x2_data = geometry.ptr<float>(0, 2, y);
-        const float* x3_data = geometry.ptr<float>(0, 3, y);
-        const float* anglesData = geometry.ptr<float>(0, 4, y);
-        for (int x = 0; x < width; ++x)
-        {
-            float score = scoresData[x];
-            if (score < confidenceMinimumThreshold)
-                continue;
-
-            // Decode a prediction.
-            // Multiple by 4 because feature maps are 4 time less than input image.
-            float offsetX = x * 4.0f, offsetY = y * 4.0f;
-            float angle = anglesData[x];
-            float cosA = std::cos(angle);
-            float sinA = std::sin(angle);
-            float h = x0_data[x] + x2_data[x];
-            float w = x1_data[x] + x3_data[x];
-
-            cv::Point2f offset(
-                offsetX + cosA * x1_data[x] + sinA * x2_data[x],
-                offsetY - sinA * x1_data[x] + cosA * x2_data[x]);
-            cv::Point2f p1 = cv::Point2f(-sinA * h, -cosA * h) + offset;
-            cv::Point2f p3 = cv::Point2f(-cosA * w, sinA * w) + offset;
-            cv::RotatedRect r(0.5f * (p1 + p3),
-                cv::Size2f(w, h), -angle * 180.0f / (float)CV_PI);
-            detections.push_back(r);
-            confidences.push_back(score);
-        }
+    cv::TickMeter tickMeter;
+    tickMeter.start();
+
+    for (size_t index = 0; index < images.size(); index++) {
+        decodeOutput(static_cast<int>(index), *results[index]);
     }
 
-    cv::dnn::NMSBoxes(detections, confidences, confidenceMinimumThreshold,
-        nonmaximumSuppressionThreshold, indices);
+    tickMeter.stop();
+    decodeTimer.add(tickMeter.getTimeSec());
+}
+
+void TextDetector::decodeOutput(int batchIndex, TextDetections & result) {
+    result.indices.clear();
+
+    decoder.decode(outputBlobs[0], outputBlobs[1], batchIndex,
+        confidenceMinimumThreshold, result.detections, result.confidences);
+
+    cv::dnn::NMSBoxes(result.detections, result.confidences, confidenceMinimumThreshold,
+        nonmaximumSuppressionThreshold, result.indices);
 }
 
 }
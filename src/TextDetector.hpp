@@ -9,29 +9,51 @@
 #include <opencv2/dnn.hpp>
 
 #include "Config.hpp"
+#include "Metrics.hpp"
+#include "EASTDecoder.hpp"
 
 namespace tppocr {
 
+// Contents of the detector model files and the cv::dnn framework that
+// reads them. The network must keep the output layer names of EAST.
+struct TextDetectorModel {
+    std::string framework;
+    std::vector<uchar> model;
+    // Network description for frameworks that keep it apart from the
+    // weights, such as the .xml of OpenVINO
+    std::vector<uchar> config;
+
+    // Picks the framework from the extension: .pb for TensorFlow, .onnx,
+    // or .xml or .bin for OpenVINO, whose other file must be next to it
+    static TextDetectorModel read(const std::string & path);
+};
+
+struct TextDetections {
+    std::vector<cv::RotatedRect> detections;
+    std::vector<float> confidences;
+    std::vector<int> indices;
+};
+
 class TextDetector {
     cv::Mat blob;
     cv::dnn::Net network;
     std::vector<cv::Mat> outputBlobs;
     std::vector<std::string> outputBlobNames;
-    std::vector<cv::RotatedRect> detections;
-    std::vector<float> confidences;
     float confidenceMinimumThreshold = 0.5; // [0.0, 1.0]
     float nonmaximumSuppressionThreshold = 0.4; // [0.0, 1.0]
-    std::vector<int> indices;
+    EASTDecoder decoder;
+    Timer & decodeTimer;
 
 public:
-    explicit TextDetector(std::shared_ptr<Config> config);
-
-    const std::vector<cv::RotatedRect> & getDetections();
-    const std::vector<float> & getConfidences();
-    const std::vector<int> & getIndices();
+    explicit TextDetector(std::shared_ptr<Config> config,
+        const TextDetectorModel & model, Metrics & metrics);
 
-    void processImage(const cv::Mat & image);
+    // Runs the images, which must all have the same size, as one batch
+    void processImages(const std::vector<cv::Mat> & images,
+        const std::vector<TextDetections*> & results);
 
+private:
+    void decodeOutput(int batchIndex, TextDetections & result);
 };
 
 }
@@ -0,0 +1,154 @@
+#include "TextDetectorPool.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+
+namespace tppocr {
+
+TextDetectorPool::TextDetectorPool(std::shared_ptr<Config> config, Metrics & metrics) :
+    maxBatchSize(std::max(config->detectorBatchSize, static_cast<size_t>(1))),
+    maxBatchWait(config->detectorBatchTimeout),
+    batchCounter(metrics.counter("detector-batches")),
+    batchImageCounter(metrics.counter("detector-batch-images")),
+    inferenceTimer(metrics.timer("detector-inference")) {
+
+    bool hasDetectorRegion = std::any_of(config->regions.begin(), config->regions.end(),
+        [](const Region & region) { return region.usesEASTDetector(); });
+
+    if (!hasDetectorRegion) {
+        return;
+    }
+
+    auto model = TextDetectorModel::read(config->detectorModelPath);
+    auto count = std::max(config->detectorInstances, static_cast<size_t>(1));
+
+    std::cerr << "Text detector instances: " << count
+        << " max batch size: " << maxBatchSize << std::endl;
+
+    pendingRequests.reserve(64);
+
+    for (size_t index = 0; index < count; index++) {
+        detectors.push_back(std::make_unique<TextDetector>(config, model, metrics));
+    }
+
+    for (auto & detector : detectors) {
+        threads.emplace_back(&TextDetectorPool::inferenceEntry, this, std::ref(*detector));
+    }
+}
+
+TextDetectorPool::~TextDetectorPool() {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+    lock.unlock();
+    requestConditionVar.notify_all();
+
+    for (auto & thread : threads) {
+        thread.join();
+    }
+}
+
+void TextDetectorPool::processImage(const cv::Mat & image, TextDetections & result) {
+    Request request = {&image, &result, false, nullptr};
+
+    std::unique_lock<std::mutex> lock(mutex);
+    pendingRequests.push_back(&request);
+    requestConditionVar.notify_all();
+    doneConditionVar.wait(lock, [&]{ return request.done; });
+    lock.unlock();
+
+    if (request.error) {
+        std::rethrow_exception(request.error);
+    }
+}
+
+size_t TextDetectorPool::countPendingRequests(cv::Size size) {
+    return std::count_if(pendingRequests.begin(), pendingRequests.end(),
+        [&](const Request * request) { return request->image->size() == size; });
+}
+
+void TextDetectorPool::takeBatch(cv::Size size, std::vector<Request*> & batch) {
+    auto iterator = pendingRequests.begin();
+
+    while (iterator != pendingRequests.end() && batch.size() < maxBatchSize) {
+        if ((*iterator)->image->size() == size) {
+            batch.push_back(*iterator);
+            iterator = pendingRequests.erase(iterator);
+        } else {
+            ++iterator;
+        }
+    }
+}
+
+void TextDetectorPool::inferenceEntry(TextDetector & detector) {
+    std::vector<Request*> batch;
+    std::vector<cv::Mat> images;
+    std::vector<TextDetections*> results;
+
+    batch.reserve(maxBatchSize);
+    images.reserve(maxBatchSize);
+    results.reserve(maxBatchSize);
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        requestConditionVar.wait(lock, [&]{ return stopping || !pendingRequests.empty(); });
+
+        if (stopping) {
+            break;
+        }
+
+        // Give other workers a moment to submit images of the same size
+        auto size = pendingRequests.front()->image->size();
+        requestConditionVar.wait_for(lock, maxBatchWait, [&]{
+            return stopping || countPendingRequests(size) >= maxBatchSize;
+        });
+
+        // Another inference thread may have taken them in the meantime
+        takeBatch(size, batch);
+
+        if (batch.empty()) {
+            continue;
+        }
+
+        lock.unlock();
+
+        for (auto request : batch) {
+            images.push_back(*request->image);
+            results.push_back(request->result);
+        }
+
+        cv::TickMeter tickMeter;
+        std::exception_ptr error;
+        tickMeter.start();
+
+        try {
+            detector.processImages(images, results);
+        } catch (...) {
+            // Given to the waiting workers instead of ending the process
+            error = std::current_exception();
+        }
+
+        tickMeter.stop();
+
+        inferenceTimer.add(tickMeter.getTimeSec());
+        batchCounter.add();
+        batchImageCounter.add(batch.size());
+
+        images.clear();
+        results.clear();
+
+        lock.lock();
+
+        for (auto request : batch) {
+            request->error = error;
+            request->done = true;
+        }
+
+        batch.clear();
+        doneConditionVar.notify_all();
+    }
+}
+
+}
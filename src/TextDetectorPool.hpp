@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "Config.hpp"
+#include "Metrics.hpp"
+#include "TextDetector.hpp"
+
+namespace tppocr {
+
+// Text detector networks shared by all workers.
+//
+// The model is read from disk once and loaded into a small fixed number
+// of networks so memory and startup time don't grow with the worker count.
+// Each network has an inference thread that batches requests of the same
+// image size from different regions and frames into one forward pass.
+class TextDetectorPool {
+    struct Request {
+        const cv::Mat * image;
+        TextDetections * result;
+        bool done;
+        std::exception_ptr error;
+    };
+
+    std::vector<std::unique_ptr<TextDetector>> detectors;
+    std::vector<std::thread> threads;
+    std::vector<Request*> pendingRequests;
+    size_t maxBatchSize;
+    std::chrono::duration<double> maxBatchWait;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable requestConditionVar;
+    std::condition_variable doneConditionVar;
+    Counter & batchCounter;
+    Counter & batchImageCounter;
+    Timer & inferenceTimer;
+
+public:
+    explicit TextDetectorPool(std::shared_ptr<Config> config, Metrics & metrics);
+    ~TextDetectorPool();
+
+    // Queues the image for detection and blocks until it's done. An error
+    // running the batch the image was in is rethrown here.
+    void processImage(const cv::Mat & image, TextDetections & result);
+
+private:
+    void inferenceEntry(TextDetector & detector);
+    size_t countPendingRequests(cv::Size size);
+    void takeBatch(cv::Size size, std::vector<Request*> & batch);
+};
+
+}
@@ -0,0 +1,77 @@
+#include "TextPrefilter.hpp"
+
+#include <stdexcept>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "DetectionTracker.hpp"
+
+namespace tppocr {
+
+TextPrefilter::TextPrefilter(const RegionPrefilter & prefilter, Metrics & metrics) :
+    prefilter(prefilter),
+    rejectionCounter(metrics.counter("prefilter-" + prefilter.name + "-rejected")),
+    timer(metrics.timer("prefilter-" + prefilter.name)) {
+
+    if (prefilter.type == RegionPrefilter::Type::Template) {
+        templateImage = cv::imread(prefilter.templateFilename, cv::IMREAD_GRAYSCALE);
+
+        if (templateImage.empty()) {
+            throw std::runtime_error("Failed to read prefilter template "
+                + prefilter.templateFilename);
+        }
+    }
+}
+
+bool TextPrefilter::accepts(const cv::Mat & image) {
+    cv::TickMeter tickMeter;
+    tickMeter.start();
+
+    bool isAccepted = measure(image) >= prefilter.minimum;
+
+    tickMeter.stop();
+    timer.add(tickMeter.getTimeSec());
+
+    if (!isAccepted) {
+        rejectionCounter.add();
+    }
+
+    return isAccepted;
+}
+
+float TextPrefilter::measure(const cv::Mat & image) {
+    switch (prefilter.type) {
+    case RegionPrefilter::Type::EdgeDensity:
+        cv::cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
+        return DetectionTracker::computeEdgeDensity(grayImage, workImage);
+
+    case RegionPrefilter::Type::ColorFraction: {
+        // Configured as RGB, images are BGR
+        auto & lower = prefilter.lowerColor;
+        auto & upper = prefilter.upperColor;
+        cv::inRange(image,
+            cv::Scalar(lower[2], lower[1], lower[0]),
+            cv::Scalar(upper[2], upper[1], upper[0]),
+            workImage);
+        return static_cast<float>(cv::countNonZero(workImage)) / image.total();
+    }
+
+    case RegionPrefilter::Type::Template: {
+        cv::cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
+
+        if (grayImage.rows < templateImage.rows || grayImage.cols < templateImage.cols) {
+            return 0;
+        }
+
+        double maxScore;
+        cv::matchTemplate(grayImage, templateImage, workImage, cv::TM_CCOEFF_NORMED);
+        cv::minMaxLoc(workImage, nullptr, &maxScore);
+        return maxScore;
+    }
+    }
+
+    return 0;
+}
+
+}
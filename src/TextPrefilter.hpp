@@ -0,0 +1,30 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include "Region.hpp"
+#include "Metrics.hpp"
+
+namespace tppocr {
+
+// Rejects region images that clearly don't contain text so the text
+// detector doesn't need to run.
+class TextPrefilter {
+    const RegionPrefilter & prefilter;
+    cv::Mat templateImage;
+    cv::Mat grayImage;
+    cv::Mat workImage;
+    Counter & rejectionCounter;
+    Timer & timer;
+
+public:
+    explicit TextPrefilter(const RegionPrefilter & prefilter, Metrics & metrics);
+
+    // Whether the region image (BGR) may contain text
+    bool accepts(const cv::Mat & image);
+
+private:
+    float measure(const cv::Mat & image);
+};
+
+}
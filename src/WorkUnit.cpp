@@ -2,11 +2,13 @@
 
 namespace tppocr {
 
-WorkUnit::WorkUnit(unsigned int id, unsigned int frameID,
-        cv::Mat image, cv::Mat debugImage) :
+WorkUnit::WorkUnit(unsigned int id, FrameRef frame, const Region & region) :
     id(id),
-    frameID(frameID),
-    image(image),
-    debugImage(debugImage) {}
+    frameID(frame->frameID),
+    region(&region),
+    frame(frame),
+    image(frame->image),
+    grayImage(frame->grayImage),
+    debugImage(frame->debugImage) {}
 
 }
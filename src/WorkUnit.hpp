@@ -6,16 +6,23 @@
 #include "Region.hpp"
 #include "TextDetector.hpp"
 #include "OCR.hpp"
+#include "FramePool.hpp"
 
 namespace tppocr {
 
+// A region of a frame to be processed
 struct WorkUnit {
-    unsigned int id;
-    unsigned int frameID;
+    unsigned int id = 0;
+    unsigned int frameID = 0;
+    const Region * region = nullptr;
+    // Keeps the pooled buffer borrowed while the images are in use
+    FrameRef frame;
     cv::Mat image;
+    cv::Mat grayImage;
     cv::Mat debugImage;
 
-    explicit WorkUnit(unsigned int id, unsigned int frameID, cv::Mat image, cv::Mat debugImage);
+    WorkUnit() = default;
+    explicit WorkUnit(unsigned int id, FrameRef frame, const Region & region);
 };
 
 }
@@ -1,11 +1,43 @@
 #include "WorkUnitResource.hpp"
 
+#include "mathutil.hpp"
+
 namespace tppocr {
 
-WorkUnitResource::WorkUnitResource(std::shared_ptr<Config> config) {
+WorkUnitResource::WorkUnitResource(std::shared_ptr<Config> config, Metrics & metrics,
+        const GlyphAtlases & glyphAtlases) :
+    projectionTextDetector(metrics) {
+    auto & allocationCounter = metrics.counter("region-buffer-allocations");
+
     for (auto & region : config->regions) {
-        textDetectors.emplace(region.name, config);
-        textRecognizers.try_emplace(region.name, config, region);
+        textRecognizers.try_emplace(region.name, config, region, metrics);
+        regionSignatures.try_emplace(region.name);
+
+        if (region.recognizerType == TextRecognizerType::Glyph) {
+            glyphRecognizers.try_emplace(region.name, region,
+                glyphAtlases.at(region.name), metrics);
+        }
+
+        if (!region.alwaysHasText) {
+            textDetections.try_emplace(region.name);
+
+            auto & regionPrefilters = prefilters[region.name];
+            regionPrefilters.reserve(region.prefilters.size());
+
+            for (auto & prefilter : region.prefilters) {
+                regionPrefilters.emplace_back(prefilter, metrics);
+            }
+        }
+
+        if (region.usesEASTDetector()) {
+            regionImages.emplace(region.name, cv::Mat(
+                roundUp2(region.detectorHeight(), 32),
+                roundUp2(region.detectorWidth(), 32),
+                CV_8UC3,
+                cv::Scalar(0, 0)
+            ));
+            allocationCounter.add();
+        }
     }
 
     freetype = cv::freetype::createFreeType2();
@@ -7,17 +7,37 @@
 
 #include "OCR.hpp"
 #include "TextDetector.hpp"
+#include "TextPrefilter.hpp"
+#include "ProjectionTextDetector.hpp"
+#include "GlyphRecognizer.hpp"
 #include "Config.hpp"
+#include "Metrics.hpp"
 
 namespace tppocr {
 
 class WorkUnitResource {
 public:
-    std::unordered_map<std::string,TextDetector> textDetectors;
+    std::unordered_map<std::string,TextDetections> textDetections;
+    std::unordered_map<std::string,std::vector<TextPrefilter>> prefilters;
     std::unordered_map<std::string,OCR> textRecognizers;
+    std::unordered_map<std::string,GlyphRecognizer> glyphRecognizers;
+    // Detector input buffers padded to a multiple of 32 for each region
+    std::unordered_map<std::string,cv::Mat> regionImages;
+    ProjectionTextDetector projectionTextDetector;
+    // Downsampled region images for change detection
+    std::unordered_map<std::string,cv::Mat> regionSignatures;
+    // Binarized text block and its coarse cells for OCR cache keys
+    cv::Mat cacheKeyImage;
+    cv::Mat cacheSignatureImage;
+    // Tesseract's binarized text block, only kept for the debug window
+    cv::Mat thresholdedImage;
+    // Scratch images for edge density of tracked detections
+    cv::Mat edgeGrayImage;
+    cv::Mat edgeImage;
     std::shared_ptr<cv::freetype::FreeType2> freetype;
 
-    explicit WorkUnitResource(std::shared_ptr<Config> config);
+    explicit WorkUnitResource(std::shared_ptr<Config> config, Metrics & metrics,
+        const GlyphAtlases & glyphAtlases);
 
 };
 
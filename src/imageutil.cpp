@@ -0,0 +1,135 @@
+#include "imageutil.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <array>
+#include <stdint.h>
+
+#include <leptonica/allheaders.h>
+#include <tesseract/baseapi.h>
+#include <opencv2/imgproc.hpp>
+
+namespace tppocr {
+
+namespace {
+
+// The 8 unpacked pixels of each byte of a 1bpp image, most significant
+// bit first
+std::array<std::array<uint8_t,8>,256> makeBinaryTable() {
+    std::array<std::array<uint8_t,8>,256> table;
+
+    for (int byte = 0; byte < 256; byte++) {
+        for (int bit = 0; bit < 8; bit++) {
+            table[byte][bit] = ((byte >> (7 - bit)) & 1) ? 255 : 0;
+        }
+    }
+
+    return table;
+}
+
+const std::array<std::array<uint8_t,8>,256> binaryTable = makeBinaryTable();
+
+void unpackBinaryRow(const uint32_t * words, int width, uint8_t * row) {
+    // Pixels are stored most significant bit first in each 32-bit word,
+    // so bytes are taken from the top of the word rather than from memory
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32) {
+        const uint32_t word = words[x / 32];
+
+        std::memcpy(row + x, binaryTable[word >> 24].data(), 8);
+        std::memcpy(row + x + 8, binaryTable[(word >> 16) & 0xff].data(), 8);
+        std::memcpy(row + x + 16, binaryTable[(word >> 8) & 0xff].data(), 8);
+        std::memcpy(row + x + 24, binaryTable[word & 0xff].data(), 8);
+    }
+
+    if (x < width) {
+        const uint32_t word = words[x / 32];
+
+        for (int bit = 0; x + bit < width; bit++) {
+            row[x + bit] = ((word >> (31 - bit)) & 1) ? 255 : 0;
+        }
+    }
+}
+
+void unpackGrayRow(const uint32_t * words, int width, uint8_t * row) {
+    // Pixels are stored most significant byte first in each 32-bit word
+    for (int x = 0; x < width; x++) {
+        row[x] = static_cast<uint8_t>(words[x / 4] >> (24 - 8 * (x % 4)));
+    }
+}
+
+void unpackColorRow(const uint32_t * words, int width, uint8_t * row) {
+    // Each word is red, green, blue and alpha from the most significant byte
+    for (int x = 0; x < width; x++) {
+        const uint32_t word = words[x];
+
+        row[3 * x] = static_cast<uint8_t>(word >> 8);
+        row[3 * x + 1] = static_cast<uint8_t>(word >> 16);
+        row[3 * x + 2] = static_cast<uint8_t>(word >> 24);
+    }
+}
+
+}
+
+void convertPixToMat(Pix * pix, cv::Mat & image) {
+    const int width = pixGetWidth(pix);
+    const int height = pixGetHeight(pix);
+    const int depth = pixGetDepth(pix);
+    const int wordsPerLine = pixGetWpl(pix);
+    const uint32_t * data = pixGetData(pix);
+
+    if (depth != 1 && depth != 8 && depth != 32) {
+        throw std::runtime_error("Unsupported Pix depth " + std::to_string(depth));
+    }
+
+    image.create(height, width, depth == 32 ? CV_8UC3 : CV_8UC1);
+
+    for (int y = 0; y < height; y++) {
+        const uint32_t * words = data + y * wordsPerLine;
+        uint8_t * row = image.ptr<uint8_t>(y);
+
+        if (depth == 1) {
+            unpackBinaryRow(words, width, row);
+        } else if (depth == 8) {
+            unpackGrayRow(words, width, row);
+        } else {
+            unpackColorRow(words, width, row);
+        }
+    }
+}
+
+void setTesseractImage(tesseract::TessBaseAPI & api, const cv::Mat & image,
+        cv::Mat & rgbImage) {
+    // Tesseract copies the rows directly from the given buffer
+    if (image.channels() == 1) {
+        api.SetImage(image.data, image.cols, image.rows, 1,
+            static_cast<int>(image.step));
+    } else {
+        // Tesseract expects RGB byte order for 3 bytes per pixel
+        cv::cvtColor(image, rgbImage, cv::COLOR_BGR2RGB);
+        api.SetImage(rgbImage.data, rgbImage.cols, rgbImage.rows, 3,
+            static_cast<int>(rgbImage.step));
+    }
+}
+
+void binarizeText(const cv::Mat & image, cv::Mat & grayImage,
+        cv::Mat & binaryImage) {
+    const cv::Mat * sourceImage = &image;
+
+    if (image.channels() != 1) {
+        cv::cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
+        sourceImage = &grayImage;
+    }
+
+    cv::threshold(*sourceImage, binaryImage, 0, 255,
+        cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+    // Text covers less of the image than its background
+    if (cv::countNonZero(binaryImage) > static_cast<int>(binaryImage.total() / 2)) {
+        cv::bitwise_not(binaryImage, binaryImage);
+    }
+}
+
+}
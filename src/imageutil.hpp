@@ -0,0 +1,28 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+struct Pix;
+
+namespace tesseract {
+class TessBaseAPI;
+}
+
+namespace tppocr {
+
+// Converts a 1bpp or 8bpp Leptonica image to a CV_8UC1 image, or a 32bpp
+// one to a CV_8UC3 BGR image. Set pixels of 1bpp images become 255.
+void convertPixToMat(Pix * pix, cv::Mat & image);
+
+// Gives a CV_8UC1 or BGR CV_8UC3 image, which may be a region of a larger
+// one, to Tesseract without building a Pix pixel by pixel. Color images
+// are converted to RGB in the reused work image.
+void setTesseractImage(tesseract::TessBaseAPI & api, const cv::Mat & image,
+    cv::Mat & rgbImage);
+
+// Binarizes a CV_8UC1 or BGR CV_8UC3 image with Otsu's threshold so text
+// is set and the background is not. The gray image is reused work space.
+void binarizeText(const cv::Mat & image, cv::Mat & grayImage,
+    cv::Mat & binaryImage);
+
+}
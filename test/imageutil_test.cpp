@@ -0,0 +1,90 @@
+// Checks convertPixToMat against reading every pixel with pixGetPixel
+
+#include <iostream>
+#include <random>
+#include <stdint.h>
+
+#include <leptonica/allheaders.h>
+#include <opencv2/core.hpp>
+
+#include "imageutil.hpp"
+
+using tppocr::convertPixToMat;
+
+namespace {
+
+Pix * makeRandomPix(int width, int height, int depth, std::mt19937 & random) {
+    Pix * pix = pixCreate(width, height, depth);
+    std::uniform_int_distribution<uint32_t> distribution;
+    const uint32_t mask = depth == 32 ? 0xffffffff : (1u << depth) - 1;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            pixSetPixel(pix, x, y, distribution(random) & mask);
+        }
+    }
+
+    return pix;
+}
+
+bool checkPix(Pix * pix) {
+    const int width = pixGetWidth(pix);
+    const int height = pixGetHeight(pix);
+    const int depth = pixGetDepth(pix);
+    cv::Mat image;
+
+    convertPixToMat(pix, image);
+
+    if (image.cols != width || image.rows != height
+            || image.channels() != (depth == 32 ? 3 : 1)) {
+        std::cerr << "Wrong image size or type for depth " << depth << std::endl;
+        return false;
+    }
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint32_t pixel;
+            pixGetPixel(pix, x, y, &pixel);
+            bool isEqual;
+
+            if (depth == 1) {
+                isEqual = image.at<uint8_t>(y, x) == (pixel ? 255 : 0);
+            } else if (depth == 8) {
+                isEqual = static_cast<uint32_t>(image.at<uint8_t>(y, x)) == pixel;
+            } else {
+                int red, green, blue;
+                extractRGBValues(pixel, &red, &green, &blue);
+                auto & color = image.at<cv::Vec3b>(y, x);
+                isEqual = color[0] == blue && color[1] == green && color[2] == red;
+            }
+
+            if (!isEqual) {
+                std::cerr << "Mismatch at " << x << "," << y << " of "
+                    << width << "x" << height << " depth " << depth << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+}
+
+int main() {
+    std::mt19937 random(1);
+    bool isPassing = true;
+
+    // Widths around the 32-bit word boundaries of each depth
+    for (int depth : {1, 8, 32}) {
+        for (int width : {1, 7, 31, 32, 33, 64, 100}) {
+            Pix * pix = makeRandomPix(width, 5, depth, random);
+            isPassing = checkPix(pix) && isPassing;
+            pixDestroy(&pix);
+        }
+    }
+
+    std::cerr << (isPassing ? "Passed" : "Failed") << std::endl;
+
+    return isPassing ? 0 : 1;
+}
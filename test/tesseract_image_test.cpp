@@ -0,0 +1,118 @@
+// Checks that setTesseractImage gives Tesseract the same pixels as the
+// Pix that OCR::processImage used to build with pixSetPixel, for a BGR
+// and a grayscale region of a larger image
+//
+// Needs eng.traineddata in the default location or TESSDATA_PREFIX since
+// Tesseract only takes images after Init(); exits with 77 (skipped)
+// without it.
+
+#include <iostream>
+#include <stdint.h>
+
+#include <leptonica/allheaders.h>
+#include <tesseract/baseapi.h>
+#include <opencv2/core.hpp>
+
+#include "imageutil.hpp"
+
+using tppocr::setTesseractImage;
+
+namespace {
+
+const int skipExitCode = 77;
+
+// The old code shifted blue, green and red into the green, blue and
+// alpha bytes; this is the pixel it meant to build
+Pix * makePixPerPixel(const cv::Mat & image) {
+    Pix * pix = pixCreate(image.cols, image.rows, image.channels() == 1 ? 8 : 32);
+
+    for (int y = 0; y < image.rows; y++) {
+        for (int x = 0; x < image.cols; x++) {
+            uint32_t value;
+
+            if (image.channels() == 1) {
+                value = image.at<uint8_t>(y, x);
+            } else {
+                auto & color = image.at<cv::Vec3b>(y, x);
+                composeRGBPixel(color[2], color[1], color[0], &value);
+            }
+
+            pixSetPixel(pix, x, y, value);
+        }
+    }
+
+    return pix;
+}
+
+bool isSamePixels(Pix * pix, Pix * expectedPix, const char * name) {
+    if (pixGetWidth(pix) != pixGetWidth(expectedPix)
+            || pixGetHeight(pix) != pixGetHeight(expectedPix)
+            || pixGetDepth(pix) != pixGetDepth(expectedPix)) {
+        std::cerr << name << ": wrong size or depth" << std::endl;
+        return false;
+    }
+
+    const bool isColor = pixGetDepth(pix) == 32;
+
+    for (int y = 0; y < pixGetHeight(pix); y++) {
+        for (int x = 0; x < pixGetWidth(pix); x++) {
+            uint32_t pixel;
+            uint32_t expectedPixel;
+            pixGetPixel(pix, x, y, &pixel);
+            pixGetPixel(expectedPix, x, y, &expectedPixel);
+
+            // Alpha isn't used by Tesseract
+            if (isColor) {
+                pixel &= 0xffffff00;
+                expectedPixel &= 0xffffff00;
+            }
+
+            if (pixel != expectedPixel) {
+                std::cerr << name << ": mismatch at " << x << "," << y << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool checkImage(tesseract::TessBaseAPI & api, const cv::Mat & image, const char * name) {
+    cv::Mat rgbImage;
+    setTesseractImage(api, image, rgbImage);
+
+    Pix * expectedPix = makePixPerPixel(image);
+    Pix * pix = api.GetInputImage();
+    bool isPassing = pix && isSamePixels(pix, expectedPix, name);
+
+    pixDestroy(&expectedPix);
+
+    return isPassing;
+}
+
+}
+
+int main() {
+    tesseract::TessBaseAPI api;
+
+    if (api.Init(nullptr, "eng", tesseract::OEM_LSTM_ONLY)) {
+        std::cerr << "Skipped, eng trained data not found" << std::endl;
+        return skipExitCode;
+    }
+
+    cv::Mat colorImage(40, 70, CV_8UC3);
+    cv::Mat grayImage(40, 70, CV_8UC1);
+    cv::randu(colorImage, 0, 256);
+    cv::randu(grayImage, 0, 256);
+
+    // Regions so the row step is larger than the row
+    cv::Rect rect(3, 5, 33, 21);
+    bool isPassing = checkImage(api, colorImage(rect), "BGR region");
+    isPassing = checkImage(api, grayImage(rect), "gray region") && isPassing;
+
+    api.End();
+
+    std::cerr << (isPassing ? "Passed" : "Failed") << std::endl;
+
+    return isPassing ? 0 : 1;
+}